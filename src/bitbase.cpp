@@ -0,0 +1,147 @@
+#include "bitbase.h"
+#include "bitboard.h"
+
+namespace ChessEngine {
+
+namespace {  // anonymous namespace
+
+// bit  0- 5: black king square
+// bit     6: side to move
+// bit  7-12: white king square
+// bit 13-14: pawn file, FILE_A to FILE_D
+// bit 15-17: RANK_7 - pawn rank
+//
+// So every 64 bit word holds one bit per black king square, set if white wins, for a given
+// pawn, white king and side to move. 196608 bits, 24 KB.
+Bitboard KPKBitbase[Bitbases::KPK_SIZE / NUM_SQUARES];
+
+constexpr int NUM_PAWN_SQUARES = 24;
+
+inline int pawnIndex(Square pawn)
+{
+    return getFile(pawn) | ((RANK_7 - getRank(pawn)) << 2);
+}
+
+inline Bitboard& kpkWord(Color sideToMove, Square whiteKing, Square pawn)
+{
+    return KPKBitbase[sideToMove | (whiteKing << 1) | (pawnIndex(pawn) << 7)];
+}
+
+// The squares next to any of the squares
+inline Bitboard kingSpread(Bitboard bitboard)
+{
+    return shift(bitboard, NORTH)      | shift(bitboard, SOUTH)      | shift(bitboard, EAST)       | shift(bitboard, WEST)
+         | shift(bitboard, NORTH_EAST) | shift(bitboard, NORTH_WEST) | shift(bitboard, SOUTH_EAST) | shift(bitboard, SOUTH_WEST);
+}
+
+// The black king squares of the legal positions, without touching kings or a king on the
+// pawn. With white to move the black king can also not be in check by the pawn.
+inline Bitboard validSquares(Color sideToMove, Square whiteKing, Square pawn)
+{
+    if (whiteKing == pawn)
+        return 0;
+
+    Bitboard occupied = attackMask(KING, whiteKing) | whiteKing | pawn;
+
+    if (sideToMove == WHITE)
+        occupied |= pawnAttackMask(WHITE, pawn);
+
+    return ~occupied;
+}
+
+// White to move: won if a king move or a pawn push reaches a won position with black to move
+Bitboard classifyWhite(Square whiteKing, Square pawn)
+{
+    Bitboard wins = 0;
+    Bitboard kingMoves = attackMask(KING, whiteKing);
+
+    while (kingMoves)
+        wins |= kpkWord(BLACK, popSquare(kingMoves), pawn);
+
+    Square push = pawn + NORTH;
+
+    // Promotions are decided by the initial wins, the new queen is lost otherwise
+    if (getRank(pawn) < RANK_7 && push != whiteKing)
+    {
+        wins |= kpkWord(BLACK, whiteKing, push) & ~getSquareMask(push);
+
+        if (getRank(pawn) == RANK_2)
+            wins |= kpkWord(BLACK, whiteKing, push + NORTH) & ~getSquareMask(push);
+    }
+
+    return wins & validSquares(WHITE, whiteKing, pawn);
+}
+
+// Black to move: won if the black king has moves and all of them reach won positions.
+// Being stalemated, or taking an undefended pawn, is a draw.
+Bitboard classifyBlack(Square whiteKing, Square pawn)
+{
+    Bitboard legalTargets = validSquares(WHITE, whiteKing, pawn);
+    Bitboard escapes      = legalTargets & ~kpkWord(WHITE, whiteKing, pawn);
+    Bitboard draws        = ~kingSpread(legalTargets) | kingSpread(escapes);
+
+    if (!(attackMask(KING, whiteKing) & pawn))
+        draws |= attackMask(KING, pawn);
+
+    return validSquares(BLACK, whiteKing, pawn) & ~draws;
+}
+
+} // anonymous namespace
+
+// The won positions are found by retrograde iteration starting from the safe promotions, every
+// position that is not won once the iteration stops growing is a draw. All black king squares of
+// a pawn and a white king are classified at once, a word of the bitbase at a time.
+// See: https://www.chessprogramming.org/Retrograde_Analysis
+void Bitbases::init()
+{
+    for (Bitboard& word : KPKBitbase)
+        word = 0;
+
+    // The pawn promotes and the new queen cannot be captured
+    for (Square pawn = A7; pawn <= D7; pawn++)
+    {
+        Square promotion = pawn + NORTH;
+
+        for (Square whiteKing = A1; whiteKing < NUM_SQUARES; whiteKing++)
+        {
+            if (whiteKing == promotion)
+                continue;
+
+            Bitboard safe = (distance(whiteKing, promotion) == 1 ? ~Bitboard(0) : ~(attackMask(KING, promotion) | promotion));
+            kpkWord(WHITE, whiteKing, pawn) = safe & validSquares(WHITE, whiteKing, pawn);
+        }
+    }
+
+    // The results are written in place, so a pass already builds on the wins found earlier in it
+    bool changed = true;
+
+    while (changed)
+    {
+        changed = false;
+
+        for (int index = 0; index < NUM_PAWN_SQUARES; index++)
+        {
+            Square pawn = createSquare(File(index & 3), Rank(RANK_7 - (index >> 2)));
+
+            for (Square whiteKing = A1; whiteKing < NUM_SQUARES; whiteKing++)
+            {
+                for (Color color : { WHITE, BLACK })
+                {
+                    Bitboard& word = kpkWord(color, whiteKing, pawn);
+                    Bitboard wins  = word | (color == WHITE ? classifyWhite(whiteKing, pawn) : classifyBlack(whiteKing, pawn));
+
+                    changed |= (wins != word);
+                    word = wins;
+                }
+            }
+        }
+    }
+}
+
+bool Bitbases::probeKPK(Square whiteKing, Square pawn, Square blackKing, Color sideToMove)
+{
+    assert(getFile(pawn) <= FILE_D);
+    return kpkWord(sideToMove, whiteKing, pawn) & blackKing;
+}
+
+} // namespace ChessEngine
@@ -0,0 +1,25 @@
+#ifndef BITBASE_INCLUDED
+#define BITBASE_INCLUDED
+
+#include "defs.h"
+
+namespace ChessEngine {
+
+namespace Bitbases {
+
+// King, pawn and king positions with the pawn on one of the files a to d and the ranks 2 to 7,
+// either side to move. The other files are mirrored onto these.
+constexpr int KPK_SIZE = 2 * 24 * NUM_SQUARES * NUM_SQUARES;
+
+// Solves every KPK position by retrograde iteration and packs the results into one bit each
+void init();
+
+// Whether the position is won for the side with the pawn, given from that side's point of view
+// as white with the pawn on the files a to d. Positions that cannot occur are never looked up.
+bool probeKPK(Square whiteKing, Square pawn, Square blackKing, Color sideToMove);
+
+} // namespace Bitbases
+
+} // namespace ChessEngine
+
+#endif // BITBASE_INCLUDED
@@ -4,190 +4,125 @@
 
 namespace ChessEngine {
 
-Bitboard squareMasks[NUM_SQUARES];
-Bitboard lineMask[NUM_SQUARES][NUM_SQUARES];
-Bitboard betweenMask[NUM_SQUARES][NUM_SQUARES];
-Bitboard pawnAttacks[NUM_COLORS][NUM_SQUARES];
-Bitboard pseudoAttacks[NUM_PIECE_TYPES][NUM_SQUARES];
-
-Magic bishopMagics[NUM_SQUARES];
-Magic rookMagics[NUM_SQUARES];
-
 namespace {  // anonymous namespace
 
-Bitboard bishopAttackTable[5248];
-Bitboard rookAttackTable[102400];
-
-void initMagics(PieceType pt, Magic magics[], Bitboard attackTable[]);
-Bitboard slidingAttack(PieceType pt, Square attackerSquare, Bitboard blockers);
-inline int numBits(Bitboard bitboard);
-
-inline void initAttackTables(Square sq);
-inline void initLineAndBetweenMasks(Square from);
-
-constexpr Bitboard pawnAttackMask(Bitboard pawn, Color color);
-constexpr Bitboard kingAttackMask(Bitboard king);
-constexpr Bitboard knightAttackMask(Bitboard knight);
-
-inline uint32_t random32();
-inline Bitboard random64();
-inline Bitboard random64FewBits();
-
-} // anonymous namespace
-
-void Bitboards::init()
+// Magic numbers found once with a brute force search over sparse random numbers.
+// Each of them maps every blocker permutation of its square to the correct attack
+// without collisions, which is verified when the tables are computed.
+constexpr Bitboard BishopMagicNumbers[NUM_SQUARES] = {
+    0x0040040822862081ULL, 0x0004011802028400ULL, 0x0014034401000410ULL, 0x0008204242840040ULL,
+    0x488404200A000040ULL, 0x0002010420000400ULL, 0x20150807042000A0ULL, 0x0022010108410402ULL,
+    0x0000080908218411ULL, 0x8228300101010200ULL, 0x0005846800810902ULL, 0x04000820A0200000ULL,
+    0x0002840504254104ULL, 0x004806091018020CULL, 0x0608508184202004ULL, 0x21000C2098280819ULL,
+    0x2020004242020200ULL, 0x4102100490040101ULL, 0x0114012208001500ULL, 0x0108000682004460ULL,
+    0x7809000490401000ULL, 0x8C02001120900808ULL, 0x4024016100821001ULL, 0x0041004024050420ULL,
+    0x084440422002C400ULL, 0x0119111094040810ULL, 0x4404480810048010ULL, 0x042011000802400CULL,
+    0x8001001009004000ULL, 0x4010108001004128ULL, 0x600202009402C204ULL, 0x0210848182021280ULL,
+    0x0012021000C01120ULL, 0x001A482A00041020ULL, 0x1002404800100930ULL, 0x0002008020420200ULL,
+    0x0020040C0002C102ULL, 0x0006080200804050ULL, 0x9A82089908440401ULL, 0x0038050046102202ULL,
+    0x0188084884400911ULL, 0x0004008249009020ULL, 0x1C02001048200401ULL, 0x6002520214041A02ULL,
+    0x2800401091000200ULL, 0x0044910051001200ULL, 0x2018080860420082ULL, 0xD003410101000A02ULL,
+    0x20088A18208C0040ULL, 0x012A010101100100ULL, 0x00004241D4100310ULL, 0x004000008C240010ULL,
+    0xD048282060410880ULL, 0xCD82401002062100ULL, 0x0288C20806240014ULL, 0x1820843102002050ULL,
+    0x008200C844100804ULL, 0x01109460A4102800ULL, 0x100020004C140400ULL, 0x0042070002840404ULL,
+    0x0000350020046404ULL, 0x2400810850030A00ULL, 0x01015060A1092212ULL, 0x0020202444802040ULL
+};
+
+constexpr Bitboard RookMagicNumbers[NUM_SQUARES] = {
+    0x7180029224804000ULL, 0x6040100020014001ULL, 0x5900140900200040ULL, 0x8100210038045000ULL,
+    0x4080040003800800ULL, 0x010004005100481AULL, 0x008002000F002080ULL, 0xC080004021000480ULL,
+    0x00808000924001A0ULL, 0x0088802001400880ULL, 0x0411001042200101ULL, 0x0105002100281001ULL,
+    0x2201000800450010ULL, 0x0052800200040081ULL, 0x0002000142000884ULL, 0xC002000112004084ULL,
+    0x0040028000204482ULL, 0x0020420020820900ULL, 0x1002020020804411ULL, 0x0028808008001004ULL,
+    0x0418010009000411ULL, 0x540080800C000200ULL, 0x0100840058050250ULL, 0x8080460000C401A1ULL,
+    0x020080208001C000ULL, 0x00C0008080200448ULL, 0x0250002020040802ULL, 0x4E01001900245000ULL,
+    0x1000110100040800ULL, 0x2006000200884410ULL, 0x0008080400021009ULL, 0x0000800080186300ULL,
+    0x9C80004000402000ULL, 0xC008462002401001ULL, 0x1003883000802000ULL, 0x2010811004800800ULL,
+    0x1203801400801802ULL, 0x0112000502001028ULL, 0x0400420304004810ULL, 0x2001001041000282ULL,
+    0x0000400820808000ULL, 0x0800200040008080ULL, 0x1040C02001010012ULL, 0x0050010010210008ULL,
+    0x0202000890060020ULL, 0x2401008804010012ULL, 0x0102004408020005ULL, 0x1010508100420024ULL,
+    0x0002410080002900ULL, 0x1000208500401100ULL, 0x0002402002110100ULL, 0x0028100089006100ULL,
+    0x1060150028001100ULL, 0x004201B0080C0A00ULL, 0x010A801200010080ULL, 0x0200040080411200ULL,
+    0x0180201089020042ULL, 0x3200811108204202ULL, 0x11002000108B0041ULL, 0x1110300049002005ULL,
+    0x7310A80005001591ULL, 0x000100680C000201ULL, 0x200050420188110CULL, 0x014203814021040AULL
+};
+
+// Sum of 2^(relevant blockers) over all squares
+constexpr size_t BishopTableSize = 5248;
+constexpr size_t RookTableSize   = 102400;
+
+constexpr Bitboard squareBit(int square)
 {
-    // Init square masks
-    for (Square sq = A1; sq < NUM_SQUARES; sq++)
-        squareMasks[sq] = 1ULL << sq;
-    
-    initMagics(BISHOP, bishopMagics, bishopAttackTable);
-    initMagics(ROOK, rookMagics, rookAttackTable);
-
-    for (Square sq = A1; sq < NUM_SQUARES; sq++)
-    {
-        initAttackTables(sq);
-        initLineAndBetweenMasks(sq);
-    }
+    return 1ULL << square;
 }
 
-void Bitboards::print(Bitboard bitboard)
+constexpr int numBits(Bitboard bitboard)
 {
-    std::cout << "    bitboard: " << bitboard << "\n";
-    std::cout << "  +---+---+---+---+---+---+---+---+\n";
+    int numBits = 0;
 
-    for (Rank rank = RANK_8; rank >= RANK_1; rank--)
+    while (bitboard)
     {
-        std::cout << rank+1 << " ";
-        for (File file = FILE_A; file < NUM_FILES; file++)
-            std::cout << ((bitboard & getSquareMask(rank, file)) ? "| X " : "|   ");
-
-        std::cout << "| \n  +---+---+---+---+---+---+---+---+\n";
+        bitboard &= bitboard - 1;
+        numBits++;
     }
     
-    std::cout << "    a   b   c   d   e   f   g   h\n" << std::endl;
+    return numBits;
 }
 
-namespace {  // anonymous namespace
+// Rook directions first, the squares grow along the first two directions of each piece
+constexpr Direction RayDirections[8] = {NORTH, EAST, SOUTH, WEST, NORTH_EAST, NORTH_WEST, SOUTH_EAST, SOUTH_WEST};
+
+// The squares from the given square up to the board edge in every ray direction
+struct Rays { Bitboard table[NUM_SQUARES][8]; };
 
-// Precalculates all bishop and rook attacks and uses the fancy magic bitboard
-// technique to make a lookup with a board state to see where the sliding piece
-// attacks. For reference, see: https://www.chessprogramming.org/Magic_Bitboards
-void initMagics(PieceType pt, Magic magics[], Bitboard attackTable[])
+constexpr Rays initRays()
 {
-    Bitboard blockers[4096], reference[4096], edgeMask;
-    int epoch[4096] = {}, size = 0, count = 0;
+    Rays rays{};
 
-    for (Square square = A1; square < NUM_SQUARES; square++)
+    for (int sq = A1; sq < NUM_SQUARES; sq++)
     {
-        // Alias for the curent magic
-        Magic& m = magics[square];
-
-        edgeMask = ((Rank1Mask | Rank8Mask) & ~getRankMask(square)) |
-                   ((FileAMask | FileHMask) & ~getFileMask(square));
-
-        // Init magic members
-        m.mask = slidingAttack(pt, square, 0) & ~edgeMask;
-        m.shift = NUM_SQUARES - numBits(m.mask);
-        m.attacks = (square == A1) ? attackTable : magics[square-1].attacks + size;
-
-        // Carry-Rippler trick to enumerate all permutations of blockers that can
-        // block the piece. https://www.chessprogramming.org/Traversing_Subsets_of_a_Set
-        Bitboard bitboard = 0;
-        size = 0;
-        do
-        {
-            reference[size] = slidingAttack(pt, square, bitboard);
-            blockers[size] = bitboard;
-            bitboard = (bitboard - m.mask) & m.mask;
-            size++;
-        } while (bitboard);
-
-        // Brute force to find a magic number that maps every permutation of blockers 
-        // to an index that looks up the correct sliding attack in the attackTable.
-        for (int i = 0; i < size;)
+        for (int i = 0; i < 8; i++)
         {
-            m.magic = random64FewBits();
-
-            // Verify that the magic number maps each blockers to an index that 
-            // looks up the correct sliding attack
-            for (count++, i = 0; i < size; i++)
-            {
-                uint32_t index = m.index(blockers[i]);
-
-                if (epoch[index] < count)
-                {
-                    epoch[index] = count;
-                    m.attacks[index] = reference[i];
-                }
-
-                else if (m.attacks[index] != reference[i]) // magic number did not work
-                    break;
-            }   
+            Bitboard square = squareBit(sq);
+
+            while ((square = shift(square, RayDirections[i])))
+                rays.table[sq][i] |= square;
         }
     }
+
+    return rays;
 }
 
+constexpr Rays rays = initRays();
+
 // Returns a bitmask for all squares that the given sliding piece attacks, counting up until
-// the board edge or a blocker from the given blockers.
-Bitboard slidingAttack(PieceType pt, Square attackerSquare, Bitboard blockers)
+// the board edge or a blocker from the given blockers. Each ray is cut off behind its nearest
+// blocker, which is the lowest set bit for the growing directions and the highest otherwise.
+constexpr Bitboard slidingAttack(PieceType pt, int attackerSquare, Bitboard blockers)
 {
     Bitboard attacks = 0;
 
-    Direction plus[]   = {NORTH, SOUTH, EAST, WEST};
-    Direction cross[]  = {NORTH_EAST, SOUTH_EAST, SOUTH_WEST, NORTH_WEST};
-
-    for (Direction dir : (pt == BISHOP ? cross : plus))
+    for (int i = (pt == BISHOP ? 4 : 0); i < (pt == BISHOP ? 8 : 4); i++)
     {
-        Square sq = attackerSquare;
+        Bitboard ray     = rays.table[attackerSquare][i];
+        Bitboard blocked = ray & blockers;
+
+        if (blocked)
+            ray &= ~rays.table[RayDirections[i] > 0 ? __builtin_ctzll(blocked) : 63 - __builtin_clzll(blocked)][i];
 
-        while (shift(squareMasks[sq], dir) && !(squareMasks[sq] & blockers))
-            attacks |= squareMasks[sq += dir];
+        attacks |= ray;
     }
 
     return attacks;
 }
 
-inline int numBits(Bitboard bitboard)
+// The squares whose occupancy changes the attacks of the slider, the board edge never blocks anything
+constexpr Bitboard relevantBlockers(PieceType pt, int square)
 {
-    int numBits = 0;
-
-    while (bitboard)
-    {
-        bitboard &= bitboard - 1;
-        numBits++;
-    }
-    
-    return numBits;
-}
+    Bitboard edgeMask = ((Rank1Mask | Rank8Mask) & ~getRankMask(Square(square))) |
+                        ((FileAMask | FileHMask) & ~getFileMask(Square(square)));
 
-inline void initAttackTables(Square sq)
-{
-    pawnAttacks[WHITE][sq]    = pawnAttackMask(squareMasks[sq], WHITE);
-    pawnAttacks[BLACK][sq]    = pawnAttackMask(squareMasks[sq], BLACK);
-    pseudoAttacks[KING][sq]   = kingAttackMask(squareMasks[sq]);
-    pseudoAttacks[KNIGHT][sq] = knightAttackMask(squareMasks[sq]);
-    pseudoAttacks[BISHOP][sq] = attackMask(BISHOP, sq, 0);
-    pseudoAttacks[ROOK][sq]   = attackMask(ROOK,   sq, 0);
-    pseudoAttacks[QUEEN][sq]  = pseudoAttacks[BISHOP][sq] | pseudoAttacks[ROOK][sq];
-}
-
-inline void initLineAndBetweenMasks(Square from)
-{
-    for (Square to = A1; to < NUM_SQUARES; to++)
-    {
-        for (PieceType pt : { BISHOP, ROOK })
-        {
-            if (pseudoAttacks[pt][from] & to)
-            {
-                lineMask[from][to]    = (attackMask(pt, from, 0) & attackMask(pt, to, 0)) | from | to;
-                betweenMask[from][to] = (attackMask(pt, from, getSquareMask(to)) & attackMask(pt, to, getSquareMask(from)));
-            }
-
-            // Also add the destination square
-            betweenMask[from][to] |= to;
-        }
-    }
+    return slidingAttack(pt, square, 0) & ~edgeMask;
 }
 
 constexpr Bitboard pawnAttackMask(Bitboard pawn, Color color)
@@ -212,31 +147,223 @@ constexpr Bitboard knightAttackMask(Bitboard knight)
            shift(shift(knight, WEST),  NORTH_WEST) | shift(shift(knight,  WEST), SOUTH_WEST);
 }
 
-inline uint32_t random32()
+constexpr std::array<Bitboard, NUM_SQUARES> initSquareMasks()
 {
-    static uint32_t random = 1804289383;
-    
-    // XOR shift algorithm
-    random ^= random << 13;
-    random ^= random >> 17;
-    random ^= random << 5;
-    
-    return random;
+    std::array<Bitboard, NUM_SQUARES> masks{};
+
+    for (int sq = A1; sq < NUM_SQUARES; sq++)
+        masks[sq] = squareBit(sq);
+
+    return masks;
 }
 
-inline Bitboard random64()
+constexpr BitboardTable<NUM_COLORS, NUM_SQUARES> initPawnAttacks()
 {
-    return ((Bitboard)((random32()) & 0xFFFF) << 0)  |
-           ((Bitboard)((random32()) & 0xFFFF) << 16) |
-           ((Bitboard)((random32()) & 0xFFFF) << 32) |
-           ((Bitboard)((random32()) & 0xFFFF) << 48);
+    BitboardTable<NUM_COLORS, NUM_SQUARES> attacks{};
+
+    for (int sq = A1; sq < NUM_SQUARES; sq++)
+    {
+        attacks[WHITE][sq] = pawnAttackMask(squareBit(sq), WHITE);
+        attacks[BLACK][sq] = pawnAttackMask(squareBit(sq), BLACK);
+    }
+
+    return attacks;
 }
 
-inline Bitboard random64FewBits() 
+constexpr BitboardTable<NUM_PIECE_TYPES, NUM_SQUARES> initPseudoAttacks()
 {
-    return random64() & random64() & random64();
+    BitboardTable<NUM_PIECE_TYPES, NUM_SQUARES> attacks{};
+
+    for (int sq = A1; sq < NUM_SQUARES; sq++)
+    {
+        attacks[KING][sq]   = kingAttackMask(squareBit(sq));
+        attacks[KNIGHT][sq] = knightAttackMask(squareBit(sq));
+        attacks[BISHOP][sq] = slidingAttack(BISHOP, sq, 0);
+        attacks[ROOK][sq]   = slidingAttack(ROOK,   sq, 0);
+        attacks[QUEEN][sq]  = attacks[BISHOP][sq] | attacks[ROOK][sq];
+    }
+
+    return attacks;
 }
 
+constexpr std::array<Bitboard, NUM_FILES> initAdjacentFilesMasks()
+{
+    std::array<Bitboard, NUM_FILES> masks{};
+
+    for (int file = FILE_A; file < NUM_FILES; file++)
+        masks[file] = shift(FileAMask << file, WEST) | shift(FileAMask << file, EAST);
+
+    return masks;
+}
+
+// The squares in front of the square on its file, from the given side's point of view
+constexpr BitboardTable<NUM_COLORS, NUM_SQUARES> initForwardFileMasks()
+{
+    BitboardTable<NUM_COLORS, NUM_SQUARES> masks{};
+
+    for (int sq = A1; sq < NUM_SQUARES; sq++)
+    {
+        masks[WHITE][sq] = rays.table[sq][0];  // NORTH
+        masks[BLACK][sq] = rays.table[sq][2];  // SOUTH
+    }
+
+    return masks;
+}
+
+// The squares a pawn on the square can ever attack when it advances
+constexpr BitboardTable<NUM_COLORS, NUM_SQUARES> initPawnAttackSpans()
+{
+    BitboardTable<NUM_COLORS, NUM_SQUARES> spans{};
+
+    for (int sq = A1; sq < NUM_SQUARES; sq++)
+    {
+        spans[WHITE][sq] = shift(rays.table[sq][0], WEST) | shift(rays.table[sq][0], EAST);
+        spans[BLACK][sq] = shift(rays.table[sq][2], WEST) | shift(rays.table[sq][2], EAST);
+    }
+
+    return spans;
+}
+
+constexpr BitboardTable<NUM_SQUARES, NUM_SQUARES> initLineMasks()
+{
+    BitboardTable<NUM_SQUARES, NUM_SQUARES> masks{};
+
+    for (int from = A1; from < NUM_SQUARES; from++)
+        for (int to = A1; to < NUM_SQUARES; to++)
+            for (PieceType pt : { BISHOP, ROOK })
+                if (slidingAttack(pt, from, 0) & squareBit(to))
+                    masks[from][to] = (slidingAttack(pt, from, 0) & slidingAttack(pt, to, 0)) | squareBit(from) | squareBit(to);
+
+    return masks;
+}
+
+constexpr BitboardTable<NUM_SQUARES, NUM_SQUARES> initBetweenMasks()
+{
+    BitboardTable<NUM_SQUARES, NUM_SQUARES> masks{};
+
+    for (int from = A1; from < NUM_SQUARES; from++)
+    {
+        for (int to = A1; to < NUM_SQUARES; to++)
+        {
+            for (PieceType pt : { BISHOP, ROOK })
+                if (slidingAttack(pt, from, 0) & squareBit(to))
+                    masks[from][to] = slidingAttack(pt, from, squareBit(to)) & slidingAttack(pt, to, squareBit(from));
+
+            // Also add the destination square
+            masks[from][to] |= squareBit(to);
+        }
+    }
+
+    return masks;
+}
+
+template<size_t Size>
+struct AttackTable { Bitboard entries[Size]; };
+
+// Precalculates all bishop and rook attacks with the fancy magic bitboard technique, every
+// square gets a slice of the table indexed by the magic hash of the blockers. Two blocker
+// permutations sharing an index with different attacks mean a bad magic number, which throws
+// and so fails the compile time evaluation. See: https://www.chessprogramming.org/Magic_Bitboards
+// With USE_PEXT the slice is indexed by the PEXT of the blockers instead.
+template<size_t Size>
+constexpr AttackTable<Size> initAttackTable(PieceType pt, const Bitboard magicNumbers[])
+{
+    AttackTable<Size> attackTable{};
+    size_t offset = 0;
+
+    for (int square = A1; square < NUM_SQUARES; square++)
+    {
+        Bitboard mask  = relevantBlockers(pt, square);
+#if defined(USE_PEXT)
+        uint32_t index = 0;
+#else
+        uint32_t shift = NUM_SQUARES - numBits(mask);
+#endif
+
+        // Carry-Rippler trick to enumerate all permutations of blockers that can
+        // block the piece. https://www.chessprogramming.org/Traversing_Subsets_of_a_Set
+        Bitboard blockers = 0;
+        do
+        {
+#if defined(USE_PEXT)
+            // The Carry-Rippler counts up through the subsets in the order of their PEXT index
+            Bitboard& entry  = attackTable.entries[offset + index++];
+#else
+            Bitboard& entry  = attackTable.entries[offset + ((blockers * magicNumbers[square]) >> shift)];
+#endif
+            Bitboard attacks = slidingAttack(pt, square, blockers);
+
+            // A slider always attacks at least one square, so 0 marks an unused entry
+            if (entry && entry != attacks)
+                throw "Magic number collision";
+
+            entry = attacks;
+            blockers = (blockers - mask) & mask;
+        } while (blockers);
+
+        offset += size_t(1) << numBits(mask);
+    }
+
+    if (offset != Size)
+        throw "Wrong attack table size";
+
+    return attackTable;
+}
+
+constexpr std::array<Magic, NUM_SQUARES> initMagics(PieceType pt, const Bitboard magicNumbers[], const Bitboard* attackTable)
+{
+    std::array<Magic, NUM_SQUARES> magics{};
+
+    for (int square = A1; square < NUM_SQUARES; square++)
+    {
+        Magic& m = magics[square];
+
+        m.mask    = relevantBlockers(pt, square);
+        m.attacks = attackTable;
+#if !defined(USE_PEXT)
+        m.magic   = magicNumbers[square];
+        m.shift   = NUM_SQUARES - numBits(m.mask);
+#endif
+
+        attackTable += size_t(1) << numBits(m.mask);
+    }
+
+    return magics;
+}
+
+constexpr AttackTable<BishopTableSize> bishopAttackTable = initAttackTable<BishopTableSize>(BISHOP, BishopMagicNumbers);
+constexpr AttackTable<RookTableSize>   rookAttackTable   = initAttackTable<RookTableSize>  (ROOK,   RookMagicNumbers);
+
 } // anonymous namespace
 
-} // namespace ChessEngine
\ No newline at end of file
+constexpr std::array<Bitboard, NUM_SQUARES> squareMasks = initSquareMasks();
+constexpr BitboardTable<NUM_SQUARES, NUM_SQUARES> lineMask    = initLineMasks();
+constexpr BitboardTable<NUM_SQUARES, NUM_SQUARES> betweenMask = initBetweenMasks();
+constexpr BitboardTable<NUM_COLORS, NUM_SQUARES> pawnAttacks = initPawnAttacks();
+constexpr BitboardTable<NUM_PIECE_TYPES, NUM_SQUARES> pseudoAttacks = initPseudoAttacks();
+
+constexpr std::array<Bitboard, NUM_FILES> adjacentFilesMask = initAdjacentFilesMasks();
+constexpr BitboardTable<NUM_COLORS, NUM_SQUARES> forwardFileMask = initForwardFileMasks();
+constexpr BitboardTable<NUM_COLORS, NUM_SQUARES> pawnAttackSpan  = initPawnAttackSpans();
+
+constexpr std::array<Magic, NUM_SQUARES> bishopMagics = initMagics(BISHOP, BishopMagicNumbers, bishopAttackTable.entries);
+constexpr std::array<Magic, NUM_SQUARES> rookMagics   = initMagics(ROOK,   RookMagicNumbers,   rookAttackTable.entries);
+
+void Bitboards::print(Bitboard bitboard)
+{
+    std::cout << "    bitboard: " << bitboard << "\n";
+    std::cout << "  +---+---+---+---+---+---+---+---+\n";
+
+    for (Rank rank = RANK_8; rank >= RANK_1; rank--)
+    {
+        std::cout << rank+1 << " ";
+        for (File file = FILE_A; file < NUM_FILES; file++)
+            std::cout << ((bitboard & getSquareMask(rank, file)) ? "| X " : "|   ");
+
+        std::cout << "| \n  +---+---+---+---+---+---+---+---+\n";
+    }
+    
+    std::cout << "    a   b   c   d   e   f   g   h\n" << std::endl;
+}
+
+} // namespace ChessEngine
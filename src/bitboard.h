@@ -2,17 +2,19 @@
 #define BITBOARD_INCLUDED
 
 #include <stdint.h>
+#include <array>
 #include <cassert>
 
 #include "defs.h"
 
+#if defined(USE_PEXT)
+#include <immintrin.h>
+#endif
+
 namespace ChessEngine {
 
 namespace Bitboards {
 
-// Initializes pre-calculated attack tables using magic bitboards
-void init();
-
 // Prints the given bitboard to stdout
 void print(Bitboard bitboard);
 
@@ -23,25 +25,45 @@ constexpr Bitboard Rank8Mask = Rank1Mask << (8 * 7);
 constexpr Bitboard FileAMask = 0x0101010101010101;
 constexpr Bitboard FileHMask = FileAMask << 7;
 
-// Global pre-calculated tables
-extern Bitboard squareMasks[NUM_SQUARES];
-extern Bitboard lineMask[NUM_SQUARES][NUM_SQUARES];
-extern Bitboard betweenMask[NUM_SQUARES][NUM_SQUARES];
-extern Bitboard pawnAttacks[NUM_COLORS][NUM_SQUARES];
-extern Bitboard pseudoAttacks[NUM_PIECE_TYPES][NUM_SQUARES];
+template<size_t Rows, size_t Columns>
+using BitboardTable = std::array<std::array<Bitboard, Columns>, Rows>;
+
+// Global pre-calculated tables, computed at compile time in bitboard.cpp
+extern const std::array<Bitboard, NUM_SQUARES> squareMasks;
+extern const BitboardTable<NUM_SQUARES, NUM_SQUARES> lineMask;
+extern const BitboardTable<NUM_SQUARES, NUM_SQUARES> betweenMask;
+extern const BitboardTable<NUM_COLORS, NUM_SQUARES> pawnAttacks;
+extern const BitboardTable<NUM_PIECE_TYPES, NUM_SQUARES> pseudoAttacks;
 
+// Pawn structure masks, indexed by the file or by the side and the square of the pawn
+extern const std::array<Bitboard, NUM_FILES> adjacentFilesMask;
+extern const BitboardTable<NUM_COLORS, NUM_SQUARES> forwardFileMask;
+extern const BitboardTable<NUM_COLORS, NUM_SQUARES> pawnAttackSpan;
+
+// The slider lookup of a square. The magic backend hashes the relevant blockers into the slice of
+// the square with a multiply and a shift. With USE_PEXT the BMI2 PEXT instruction packs them into
+// a dense index directly, so the slices are ordered by that index and no magic or shift is stored.
 struct Magic 
 {
-    Bitboard* attacks;
+    const Bitboard* attacks;
     Bitboard mask;
+#if !defined(USE_PEXT)
     Bitboard magic;
     uint32_t shift;
+#endif
 
-    uint32_t index(Bitboard blockers) const { return ((blockers & mask) * magic) >> shift; }
+    uint32_t index(Bitboard blockers) const
+    {
+#if defined(USE_PEXT)
+        return uint32_t(_pext_u64(blockers, mask));
+#else
+        return ((blockers & mask) * magic) >> shift;
+#endif
+    }
 };
 
-extern Magic bishopMagics[NUM_SQUARES];
-extern Magic rookMagics[NUM_SQUARES];
+extern const std::array<Magic, NUM_SQUARES> bishopMagics;
+extern const std::array<Magic, NUM_SQUARES> rookMagics;
 
 //Operators for modifying a bitboard with a square
 inline Bitboard  operator& (Bitboard  bitboard, Square square) { return bitboard &  squareMasks[square]; }
@@ -104,6 +126,30 @@ inline Bitboard pawnAttackMask(Color color, Square square)
     return pawnAttacks[color][square];
 }
 
+// The files left and right of the file
+inline Bitboard getAdjacentFilesMask(File file)
+{
+    return adjacentFilesMask[file];
+}
+
+// The squares in front of the square on the same file
+inline Bitboard getForwardFileMask(Color color, Square square)
+{
+    return forwardFileMask[color][square];
+}
+
+// The squares on the adjacent files in front of the square, which a pawn can attack as it advances
+inline Bitboard getPawnAttackSpan(Color color, Square square)
+{
+    return pawnAttackSpan[color][square];
+}
+
+// A pawn is passed if no enemy pawn is in front of it on the same or on an adjacent file
+inline Bitboard getPassedPawnMask(Color color, Square square)
+{
+    return forwardFileMask[color][square] | pawnAttackSpan[color][square];
+}
+
 inline Bitboard attackMask(PieceType pt, Square square)
 {
     assert(pt != PAWN && withinBoard(square));
@@ -152,6 +198,12 @@ inline Square firstSquare(Bitboard bitboard)
     return Square(__builtin_ctzll(bitboard));
 }
 
+// Returns the number of set bits in the given bitboard
+inline int popCount(Bitboard bitboard)
+{
+    return __builtin_popcountll(bitboard);
+}
+
 #elif defined(_MSC_VER)
 
 #ifdef _WIN64
@@ -165,6 +217,12 @@ inline Square firstSquare(Bitboard bitboard)
     return (Square)square;
 }
 
+// Returns the number of set bits in the given bitboard
+inline int popCount(Bitboard bitboard)
+{
+    return (int)__popcnt64(bitboard);
+}
+
 #endif
 
 #else
@@ -0,0 +1,57 @@
+#ifndef BOOK_INCLUDED
+#define BOOK_INCLUDED
+
+#include <string>
+
+#include "defs.h"
+
+namespace ChessEngine {
+
+class Position;
+
+namespace Book {
+
+constexpr const char* DEFAULT_FILE = "book.bin";
+
+// A Polyglot book is a list of entries sorted by key, 16 bytes each and stored big endian:
+//
+//     uint64_t key     the Polyglot key of the position, see polyglotKey()
+//     uint16_t move    bit 0-2: to file, 3-5: to rank, 6-8: from file, 9-11: from rank,
+//                      12-14: promotion piece (none, knight, bishop, rook, queen)
+//     uint16_t weight  how often the move should be played relative to the others
+//     uint32_t learn   unused
+//
+// Castling is stored as the king taking its own rook, e.g. e1h1.
+// See: http://hgm.nubati.net/book_format.html
+constexpr size_t ENTRY_SIZE = 16;
+
+// A move of the book for the current position
+struct BookMove
+{
+    Move move;
+    int weight;
+};
+
+// Maps the book, the previous one is closed first. Returns false if the file is not found
+// or is not a Polyglot book, the engine then plays without a book.
+bool open(const std::string& path);
+void close();
+bool isOpen();
+
+// The Polyglot key of the position. It has its own random numbers and, unlike the key of the
+// position, only includes the en passant file when a pawn of the side to move can capture.
+Key polyglotKey(const Position& pos);
+
+// Fills the list with the legal book moves of the position in the order of the book
+// and returns how many there are. Allocates nothing and takes O(log n) file reads.
+int probe(const Position& pos, BookMove moves[], int maxMoves);
+
+// One of the book moves picked at random by weight, or the move with the highest weight.
+// MOVE_NONE if the position is not in the book.
+Move probe(const Position& pos, bool bestMove = false);
+
+} // namespace Book
+
+} // namespace ChessEngine
+
+#endif // BOOK_INCLUDED
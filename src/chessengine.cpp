@@ -1,16 +1,105 @@
 #include <iostream>
+#include <thread>
 
 #include "defs.h"
 #include "position.h"
 #include "bitboard.h"
+#include "bitbase.h"
+#include "book.h"
 #include "movegen.h"
+#include "nnue.h"
 #include "perft.h"
+#include "tablebase.h"
 #include "test.h"
+#include "tt.h"
+#include "thread.h"
+#include "uci.h"
 
 using namespace ChessEngine;
 
 int main(int argc, char* argv[])
 {
-    Bitboards::init();
-    Test::perft();
+    Position::Init();
+    Bitbases::init();
+    TT.Resize(16);
+    Threads.Set(1);
+
+    // Falls back to the classical evaluation when there is no network next to the engine
+    NNUE::load(NNUE::DEFAULT_FILE);
+
+    // Searches every position without the tablebases when there are none
+    Tablebases::init(Tablebases::DEFAULT_DIRECTORY);
+
+    // Plays every move from the search when there is no book
+    Book::open(Book::DEFAULT_FILE);
+
+    std::string command = (argc > 1 ? argv[1] : "");
+
+    // GUIs start the engine without arguments
+    if (command.empty() || command == "uci")
+        UCI::loop();
+
+    else if (command == "perft")
+        Test::perft();
+
+    else if (command == "bench")
+        Test::bench();
+
+    else if (command == "startup")
+        Test::startup(argv[0]);
+
+    else if (command == "timesim")
+        Test::timeSimulation();
+
+    else if (command == "ucilatency")
+        Test::uciLatency(argv[0], argc > 2 ? std::stoi(argv[2]) : 64);
+
+    else if (command == "makemove")
+        Test::makeMove();
+
+    else if (command == "repetition")
+        Test::repetition();
+
+    else if (command == "tbgen")
+        Tablebases::generate(argc > 2 ? argv[2] : Tablebases::DEFAULT_DIRECTORY,
+                             argc > 3 ? std::stoi(argv[3]) : std::thread::hardware_concurrency());
+
+    else if (command == "tablebases")
+        Test::tablebases(argc > 2 ? argv[2] : Tablebases::DEFAULT_DIRECTORY);
+
+    else if (command == "book")
+        Test::book(argc > 2 ? argv[2] : "test.bin");
+
+    else if (command == "kpk")
+        Test::kpk();
+
+    else if (command == "see")
+        Test::see();
+
+    else if (command == "nnuebench")
+        Test::nnueBench();
+
+    else if (command == "sliders")
+        Test::sliders();
+
+    else if (command == "movecount")
+        Test::moveCount();
+
+    else if (command == "perftcache")
+        Test::perftCache();
+
+    else if (command == "searchbench")
+        Test::searchBench(argc > 2 ? std::stoi(argv[2]) : 6);
+
+    else if (command == "endgamebench")
+        Test::endgameBench(argc > 2 ? std::stoi(argv[2]) : 12);
+
+    else if (command == "smpbench")
+        Test::smpBench(argc > 2 ? std::stoi(argv[2]) : 6);
+
+    else if (command == "perftmt")
+        Test::perftThreads(argc > 2 ? std::stoi(argv[2]) : std::thread::hardware_concurrency());
+
+    else
+        Test::perft();
 }
\ No newline at end of file
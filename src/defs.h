@@ -8,10 +8,39 @@
 namespace ChessEngine {
 
 using Bitboard = uint64_t;
+using Key = uint64_t;
 
 const std::string startPosFEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
 
 constexpr int MAX_MOVES = 256;
+constexpr int MAX_PLY   = 128;
+
+// Nine queens or ten knights, bishops or rooks after promotions
+constexpr int MAX_PIECE_COUNT = 10;
+
+// Scores are given in centipawns from the side to move's point of view
+constexpr int VALUE_ZERO     = 0;
+constexpr int VALUE_DRAW     = 0;
+constexpr int VALUE_MATE     = 32000;
+constexpr int VALUE_INFINITE = 32001;
+constexpr int VALUE_NONE     = 32002;
+
+constexpr int VALUE_MATE_IN_MAX_PLY  =  VALUE_MATE - MAX_PLY;
+constexpr int VALUE_MATED_IN_MAX_PLY = -VALUE_MATE_IN_MAX_PLY;
+
+// A pair of midgame and endgame values, blended by the game phase when evaluating
+struct Score
+{
+    int mg;
+    int eg;
+};
+
+constexpr Score operator+(Score s1, Score s2) { return {s1.mg + s2.mg, s1.eg + s2.eg}; }
+constexpr Score operator-(Score s1, Score s2) { return {s1.mg - s2.mg, s1.eg - s2.eg}; }
+constexpr Score operator-(Score s)            { return {-s.mg, -s.eg}; }
+constexpr bool operator==(Score s1, Score s2) { return s1.mg == s2.mg && s1.eg == s2.eg; }
+inline Score& operator+=(Score& s1, Score s2) { return s1 = s1 + s2; }
+inline Score& operator-=(Score& s1, Score s2) { return s1 = s1 - s2; }
 
 // A move consist of the following four fields:
 //    
@@ -25,6 +54,15 @@ enum Move : uint16_t
   MOVE_NULL = 65
 };
 
+// The kind of bound a stored search score represents
+enum Bound : uint8_t
+{
+    BOUND_NONE,
+    BOUND_UPPER,
+    BOUND_LOWER,
+    BOUND_EXACT = BOUND_UPPER | BOUND_LOWER
+};
+
 enum MoveType
 {
   NORMAL,
@@ -83,6 +121,9 @@ enum Piece : uint8_t
     NUM_PIECES = NUM_PIECE_TYPES * NUM_COLORS
 };
 
+// Indexed by PieceType
+constexpr int PieceValue[NUM_PIECE_TYPES] = { 0, 100, 320, 330, 500, 900, 0, 0 };
+
 enum CastlingRight : uint8_t
 {
     NO_CASTLING,
@@ -141,7 +182,7 @@ constexpr Square operator+(Square s, Direction d) { return Square(int(s) + int(d
 constexpr Square operator-(Square s, Direction d) { return Square(int(s) - int(d)); }
 inline Square& operator+=(Square& s, Direction d) { return s = s + d; }
 inline Square& operator-=(Square& s, Direction d) { return s = s - d; }
-inline Color operator~(Color color) { return Color(color ^ BLACK); }
+constexpr Color operator~(Color color) { return Color(color ^ BLACK); }
 
 constexpr Square createSquare(File file, Rank rank) 
 {
@@ -168,11 +209,30 @@ constexpr Rank relativeRank(Rank rank, Color color)
     return Rank(rank ^ (color * 7));
 }
 
+// The number of king moves between the squares
+constexpr int distance(Square square, Square square2)
+{
+    int fileDistance = getFile(square) > getFile(square2) ? getFile(square) - getFile(square2) : getFile(square2) - getFile(square);
+    int rankDistance = getRank(square) > getRank(square2) ? getRank(square) - getRank(square2) : getRank(square2) - getRank(square);
+
+    return fileDistance > rankDistance ? fileDistance : rankDistance;
+}
+
 constexpr bool withinBoard(Square square)
 {
     return square >= A1 && square <= H8;
 }
 
+constexpr int mateIn(int ply)
+{
+    return VALUE_MATE - ply;
+}
+
+constexpr int matedIn(int ply)
+{
+    return -VALUE_MATE + ply;
+}
+
 constexpr Piece getPiece(PieceType pt, Color color) 
 {
     return Piece(pt | (color << 3));
@@ -0,0 +1,129 @@
+#include <algorithm>
+
+#include "endgame.h"
+#include "bitbase.h"
+#include "position.h"
+#include "movegen.h"
+
+namespace ChessEngine {
+
+namespace {  // anonymous namespace
+
+constexpr Bitboard DarkSquares = 0xAA55AA55AA55AA55ULL;
+
+// The distance of the square to the four center squares, 0 in the center and 6 in a corner
+constexpr int centerDistance(Square square)
+{
+    int file = getFile(square), rank = getRank(square);
+
+    return std::max(3 - file, file - 4) + std::max(3 - rank, rank - 4);
+}
+
+constexpr int pushToEdge(Square square)
+{
+    return 20 * centerDistance(square);
+}
+
+// The attacking king has to help, so it is pulled towards the lone king
+constexpr int pushClose(Square square, Square square2)
+{
+    return 10 * (7 - distance(square, square2));
+}
+
+int materialValue(const Position& pos, Color color)
+{
+    int value = 0;
+
+    for (PieceType pt = PAWN; pt < KING; pt++)
+        value += PieceValue[pt] * pos.NumPieces(pt, color);
+
+    return value;
+}
+
+} // anonymous namespace
+
+int Endgames::KXK(const Position& pos, Color strongSide)
+{
+    Color weakSide = ~strongSide;
+
+    // The lone king has no moves and is not in check
+    if (pos.SideToMove() == weakSide && !pos.Checkers() && MoveGen::count(pos) == 0)
+        return VALUE_DRAW;
+
+    // Bishops that are all on the same color can not mate, the material key does not know their squares
+    Bitboard bishops = pos.Pieces(BISHOP, strongSide);
+
+    if (   pos.Pieces(strongSide) == (bishops | pos.Pieces(KING, strongSide))
+        && (!(bishops & DarkSquares) || !(bishops & ~DarkSquares)))
+        return VALUE_DRAW;
+
+    Square strongKing = pos.KingSquare(strongSide);
+    Square weakKing   = pos.KingSquare(weakSide);
+
+    return VALUE_KNOWN_WIN + materialValue(pos, strongSide) + pushToEdge(weakKing) + pushClose(strongKing, weakKing);
+}
+
+int Endgames::KBNK(const Position& pos, Color strongSide)
+{
+    Color weakSide = ~strongSide;
+
+    Square strongKing = pos.KingSquare(strongSide);
+    Square weakKing   = pos.KingSquare(weakSide);
+
+    // Mate can only be forced in a corner the bishop controls, mirror the board
+    // for a light squared bishop so that the target corners are always a1 and h8
+    if (!(pos.Pieces(BISHOP, strongSide) & DarkSquares))
+        weakKing = Square(weakKing ^ 7);
+
+    int cornerDistance = std::min(distance(weakKing, A1), distance(weakKing, H8));
+
+    return VALUE_KNOWN_WIN + PieceValue[BISHOP] + PieceValue[KNIGHT]
+         + pushToEdge(weakKing) + 30 * (7 - cornerDistance) + pushClose(strongKing, weakKing);
+}
+
+int Endgames::KPK(const Position& pos, Color strongSide)
+{
+    Square strongKing = pos.KingSquare(strongSide);
+    Square weakKing   = pos.KingSquare(~strongSide);
+    Square pawn       = firstSquare(pos.Pieces(PAWN, strongSide));
+    Color us          = (pos.SideToMove() == strongSide ? WHITE : BLACK);
+
+    // The bitbase is from white's point of view with the pawn on the files a to d
+    strongKing = relativeSquare(strongKing, strongSide);
+    weakKing   = relativeSquare(weakKing,   strongSide);
+    pawn       = relativeSquare(pawn,       strongSide);
+
+    if (getFile(pawn) >= FILE_E)
+    {
+        strongKing = Square(strongKing ^ 7);
+        weakKing   = Square(weakKing   ^ 7);
+        pawn       = Square(pawn       ^ 7);
+    }
+
+    if (!Bitbases::probeKPK(strongKing, pawn, weakKing, us))
+        return VALUE_DRAW;
+
+    // Prefers advancing the pawn so the search makes progress towards the promotion
+    return VALUE_KNOWN_WIN + PieceValue[PAWN] + 10 * getRank(pawn);
+}
+
+int Endgames::draw(const Position&, Color)
+{
+    return VALUE_DRAW;
+}
+
+int Endgames::oppositeBishops(const Position& pos)
+{
+    bool whiteDark = pos.Pieces(BISHOP, WHITE) & DarkSquares;
+    bool blackDark = pos.Pieces(BISHOP, BLACK) & DarkSquares;
+
+    if (whiteDark == blackDark)
+        return SCALE_NORMAL;
+
+    // An extra pawn or two rarely wins, the defending bishop blockades on the other color
+    int pawnDifference = std::abs(pos.NumPieces(PAWN, WHITE) - pos.NumPieces(PAWN, BLACK));
+
+    return pawnDifference <= 2 ? SCALE_NORMAL / 4 : SCALE_NORMAL / 2;
+}
+
+} // namespace ChessEngine
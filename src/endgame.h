@@ -0,0 +1,46 @@
+#ifndef ENDGAME_INCLUDED
+#define ENDGAME_INCLUDED
+
+#include "defs.h"
+
+namespace ChessEngine {
+
+class Position;
+
+namespace Endgames {
+
+// A won ending is scored above any material balance of the general evaluation
+// but below the mate scores, so the search still prefers an actual mate
+constexpr int VALUE_KNOWN_WIN = 10000;
+
+// The scale of the endgame part of the general evaluation, out of SCALE_NORMAL
+constexpr int SCALE_NORMAL = 64;
+
+// Evaluates a specific ending from the strong side's point of view, replacing the general evaluation
+using EvaluationFunction = int (*)(const Position& pos, Color strongSide);
+
+// Returns the factor the endgame part of the general evaluation is scaled with
+using ScalingFunction = int (*)(const Position& pos);
+
+// A bare king against enough material to force mate, e.g. KQK and KRK.
+// Drives the lone king to the edge of the board with the other king close.
+// Only bishops all on the same color are a draw.
+int KXK(const Position& pos, Color strongSide);
+
+// King, bishop and knight against a bare king, mates in the corners of the bishop's color
+int KBNK(const Position& pos, Color strongSide);
+
+// King and pawn against a bare king, exact win or draw from the KPK bitbase
+int KPK(const Position& pos, Color strongSide);
+
+// Not enough material to mate for either side
+int draw(const Position& pos, Color strongSide);
+
+// Only bishops of opposite colors and pawns, which is drawish even with a pawn or two more
+int oppositeBishops(const Position& pos);
+
+} // namespace Endgames
+
+} // namespace ChessEngine
+
+#endif // ENDGAME_INCLUDED
@@ -0,0 +1,40 @@
+#include "evaluate.h"
+#include "nnue.h"
+#include "position.h"
+
+namespace ChessEngine {
+
+// Known endings are evaluated by their specialized function. Otherwise uses the network if one is
+// loaded, or blends the incrementally updated midgame and endgame scores of the position by the game
+// phase, so the evaluation is O(1). See: https://www.chessprogramming.org/Tapered_Eval
+int Eval::evaluate(const Position& pos, Pawns::Table& pawnTable, Material::Table& materialTable)
+{
+    using namespace Endgames;
+
+    Material::Entry* material = Material::probe(pos, materialTable);
+
+    if (material->evaluation)
+    {
+        int value = material->evaluation(pos, material->strongSide);
+        return pos.SideToMove() == material->strongSide ? value : -value;
+    }
+
+    if (NNUE::isLoaded())
+        return NNUE::evaluate(pos);
+
+    assert(pos.PsqScore() == pos.ComputePsq());
+
+    Pawns::Entry* pawns = Pawns::probe(pos, pawnTable);
+
+    Score score = pos.PsqScore() + material->imbalance + pawns->scores[WHITE] - pawns->scores[BLACK];
+    score.mg += pawns->shelter[WHITE][getFile(pos.KingSquare(WHITE))]
+              - pawns->shelter[BLACK][getFile(pos.KingSquare(BLACK))];
+
+    int phase = material->phase;
+    int scale = (material->scaling ? material->scaling(pos) : SCALE_NORMAL);
+    int value = (score.mg * phase + score.eg * scale / SCALE_NORMAL * (Material::MAX_PHASE - phase)) / Material::MAX_PHASE;
+
+    return pos.SideToMove() == WHITE ? value : -value;
+}
+
+} // namespace ChessEngine
@@ -0,0 +1,22 @@
+#ifndef EVALUATE_INCLUDED
+#define EVALUATE_INCLUDED
+
+#include "defs.h"
+#include "material.h"
+#include "pawns.h"
+
+namespace ChessEngine {
+
+class Position;
+
+namespace Eval {
+
+// Returns the static evaluation of the position from the side to move's point of view.
+// The pawn structure and the material are looked up in the tables of the calling thread
+int evaluate(const Position& pos, Pawns::Table& pawnTable, Material::Table& materialTable);
+
+} // namespace Eval
+
+} // namespace ChessEngine
+
+#endif // EVALUATE_INCLUDED
@@ -0,0 +1,130 @@
+#include <algorithm>
+
+#include "material.h"
+#include "position.h"
+
+namespace ChessEngine {
+
+namespace {  // anonymous namespace
+
+// Weighted by how much every piece type matters for the king safety
+constexpr int PhaseWeight[NUM_PIECE_TYPES] = { 0, 0, 1, 1, 2, 4, 0, 0 };
+
+constexpr Score BishopPair = {30, 50};
+
+// Knights gain and rooks lose value for every pawn of their side above five, as the
+// board gets more closed. See: https://www.chessprogramming.org/Material#Imbalances
+constexpr int KnightPawnBonus = 6;
+constexpr int RookPawnBonus   = -12;
+
+Score imbalance(const Position& pos, Color color)
+{
+    Score score = {0, 0};
+    int pawnsAboveFive = pos.NumPieces(PAWN, color) - 5;
+    int adjustment = pawnsAboveFive * (  KnightPawnBonus * pos.NumPieces(KNIGHT, color)
+                                       + RookPawnBonus   * pos.NumPieces(ROOK,   color));
+
+    if (pos.NumPieces(BISHOP, color) >= 2)
+        score += BishopPair;
+
+    return score + Score{adjustment, adjustment};
+}
+
+int nonPawnMaterial(const Position& pos, Color color)
+{
+    int value = 0;
+
+    for (PieceType pt : {KNIGHT, BISHOP, ROOK, QUEEN})
+        value += PieceValue[pt] * pos.NumPieces(pt, color);
+
+    return value;
+}
+
+// Recognizes the endings that have a specialized evaluation or scaling function
+void setEndgame(const Position& pos, Material::Entry* entry)
+{
+    entry->evaluation = nullptr;
+    entry->scaling    = nullptr;
+    entry->strongSide = WHITE;
+
+    bool noPawns = !pos.NumPieces(PAWN);
+
+    // At most a single minor piece on each side cannot mate, and neither can two knights
+    if (   noPawns
+        && nonPawnMaterial(pos, WHITE) <= PieceValue[BISHOP]
+        && nonPawnMaterial(pos, BLACK) <= PieceValue[BISHOP])
+    {
+        entry->evaluation = &Endgames::draw;
+        return;
+    }
+
+    for (Color strongSide : {WHITE, BLACK})
+    {
+        Color weakSide = ~strongSide;
+
+        if (pos.NumPieces(ALL_PIECES, weakSide) != 1)
+            continue;
+
+        int pieces = pos.NumPieces(ALL_PIECES, strongSide) - 1;
+
+        if (pieces == 2 && pos.NumPieces(KNIGHT, strongSide) == 2)
+            entry->evaluation = &Endgames::draw;
+
+        else if (pieces == 2 && pos.NumPieces(BISHOP, strongSide) == 1 && pos.NumPieces(KNIGHT, strongSide) == 1)
+            entry->evaluation = &Endgames::KBNK;
+
+        else if (pieces == 1 && pos.NumPieces(PAWN, strongSide) == 1)
+            entry->evaluation = &Endgames::KPK;
+
+        // KXK itself finds bishops that are all on one color, which the material key can not tell apart
+        else if (   pos.NumPieces(QUEEN, strongSide)
+                 || pos.NumPieces(ROOK, strongSide)
+                 || pos.NumPieces(BISHOP, strongSide) >= 2)
+            entry->evaluation = &Endgames::KXK;
+
+        entry->strongSide = strongSide;
+
+        if (entry->evaluation)
+            return;
+    }
+
+    // Each side has a single bishop and pawns, whether the bishops are on opposite colors is
+    // decided by the scaling function as the material key does not know the squares
+    if (   pos.NumPieces(BISHOP, WHITE) == 1 && pos.NumPieces(BISHOP, BLACK) == 1
+        && nonPawnMaterial(pos, WHITE) == PieceValue[BISHOP]
+        && nonPawnMaterial(pos, BLACK) == PieceValue[BISHOP])
+        entry->scaling = &Endgames::oppositeBishops;
+}
+
+} // anonymous namespace
+
+Material::Entry* Material::probe(const Position& pos, Table& table)
+{
+    Key key = pos.MaterialKey();
+    Entry* entry = table[key];
+
+    table.probes++;
+
+    if (entry->key == key)
+    {
+        table.hits++;
+        return entry;
+    }
+
+    entry->key = key;
+
+    // Promotions can take the phase above the start position
+    entry->phase = 0;
+
+    for (PieceType pt : {KNIGHT, BISHOP, ROOK, QUEEN})
+        entry->phase += PhaseWeight[pt] * pos.NumPieces(pt);
+
+    entry->phase     = std::min(entry->phase, MAX_PHASE);
+    entry->imbalance = imbalance(pos, WHITE) - imbalance(pos, BLACK);
+
+    setEndgame(pos, entry);
+
+    return entry;
+}
+
+} // namespace ChessEngine
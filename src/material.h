@@ -0,0 +1,47 @@
+#ifndef MATERIAL_INCLUDED
+#define MATERIAL_INCLUDED
+
+#include "defs.h"
+#include "endgame.h"
+
+namespace ChessEngine {
+
+class Position;
+
+namespace Material {
+
+// Everything the evaluation derives from the piece counts alone: the game phase,
+// the imbalance terms and the specialized endgame functions of a known ending
+struct Entry
+{
+    Key key;
+    int phase;
+    Score imbalance;
+    Endgames::EvaluationFunction evaluation;
+    Endgames::ScalingFunction scaling;
+    Color strongSide;
+};
+
+// A small hash table of material signatures, owned by each search thread so it needs no locking
+struct Table
+{
+    static constexpr size_t SIZE = 8192;
+
+    inline Entry* operator[](Key key) { return &entries[key & (SIZE - 1)]; }
+
+    Entry entries[SIZE];
+    uint64_t probes;
+    uint64_t hits;
+};
+
+// The game phase counts down from the full set of pieces to the endgame
+constexpr int MAX_PHASE = 24;
+
+// Returns the entry of the material signature of the position, computing it on a miss
+Entry* probe(const Position& pos, Table& table);
+
+} // namespace Material
+
+} // namespace ChessEngine
+
+#endif // MATERIAL_INCLUDED
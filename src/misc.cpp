@@ -0,0 +1,68 @@
+#include <fstream>
+#include <cstdlib>
+
+#if defined(_WIN32)
+#include <malloc.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "misc.h"
+
+namespace ChessEngine {
+
+void* mapFile(const std::string& path, size_t& size)
+{
+#if defined(_WIN32)
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+
+    if (!file)
+        return nullptr;
+
+    size = size_t(file.tellg());
+    void* data = _aligned_malloc(size, 64);
+
+    if (data && !file.seekg(0).read(static_cast<char*>(data), size))
+    {
+        _aligned_free(data);
+        data = nullptr;
+    }
+
+    return data;
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+
+    if (fd == -1)
+        return nullptr;
+
+    struct stat st;
+    void* data = nullptr;
+
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+    {
+        size = size_t(st.st_size);
+        data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (data == MAP_FAILED)
+            data = nullptr;
+    }
+
+    close(fd);
+    return data;
+#endif
+}
+
+void unmapFile(void* data, size_t size)
+{
+#if defined(_WIN32)
+    (void)size;
+    _aligned_free(data);
+#else
+    munmap(data, size);
+#endif
+}
+
+} // namespace ChessEngine
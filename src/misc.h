@@ -0,0 +1,17 @@
+#ifndef MISC_INCLUDED
+#define MISC_INCLUDED
+
+#include <string>
+
+namespace ChessEngine {
+
+// Returns the contents of the file or nullptr, mapped read only where possible. Elsewhere the
+// file is read into 64 byte aligned memory, so the contents are aligned for SIMD either way
+void* mapFile(const std::string& path, size_t& size);
+
+// Releases the contents returned by mapFile
+void unmapFile(void* data, size_t size);
+
+} // namespace ChessEngine
+
+#endif // MISC_INCLUDED
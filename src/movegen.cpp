@@ -6,46 +6,192 @@ namespace ChessEngine {
 
 namespace {  // anonymous namespace
 
-// Helper functions for generating all legal moves in the current position
-void generateKingMoves (const Position& pos, MoveList& moveList, GenType genType);
-void generatePawnMoves (const Position& pos, MoveList& moveList, GenType genType);
-void generatePieceMoves(const Position& pos, MoveList& moveList, PieceType pt, GenType genType);
+// Helper functions for generating all legal moves in the current position. They are specialized on
+// the side to move and the kind of moves generated, so the pawn directions, the promotion ranks and
+// the castling squares are constants and only the branches for the requested moves are compiled in.
+template<Color us, GenType genType> void generateMoves     (const Position& pos, MoveList& moveList);
+template<Color us, GenType genType> void generateKingMoves (const Position& pos, MoveList& moveList);
+template<Color us, GenType genType> void generatePawnMoves (const Position& pos, MoveList& moveList);
+template<Color us, PieceType pt, GenType genType> void generatePieceMoves(const Position& pos, MoveList& moveList);
+template<Color us> void generateEvasions(const Position& pos, MoveList& moveList);
+
+template<Color us> bool isLegalMove(const Position& pos, Move move);
+template<Color us> int countMoves(const Position& pos);
+template<Color us> int countPawnMoves(const Position& pos, Bitboard targets);
+
+template<Color color> inline Bitboard attackedBy(const Position& pos, Bitboard occupancy);
 
 inline void addMove(MoveList& moveList, Move move);
-inline void addPromotionMoves(MoveList& moveList, Square from, Square to);
+template<GenType genType, bool capture> inline void addPromotionMoves(MoveList& moveList, Square from, Square to);
 inline Bitboard legalSquares(const Position& pos);
 
 } // anonymous namespace
 
 void MoveGen::generate(const Position& pos, MoveList& moveList, GenType genType /*= ALL*/)
 {
-    generateKingMoves(pos, moveList, genType);
+    assert(genType != EVASIONS || pos.Checkers());
+
+    // All legal moves in check are evasions
+    if (pos.Checkers() && genType == ALL)
+        genType = EVASIONS;
+
+    bool white = (pos.SideToMove() == WHITE);
+
+    switch (genType)
+    {
+        case ALL:      white ? generateMoves<WHITE, ALL>(pos, moveList)      : generateMoves<BLACK, ALL>(pos, moveList);      break;
+        case CAPTURES: white ? generateMoves<WHITE, CAPTURES>(pos, moveList) : generateMoves<BLACK, CAPTURES>(pos, moveList); break;
+        case QUIETS:   white ? generateMoves<WHITE, QUIETS>(pos, moveList)   : generateMoves<BLACK, QUIETS>(pos, moveList);   break;
+        case EVASIONS: white ? generateEvasions<WHITE>(pos, moveList)        : generateEvasions<BLACK>(pos, moveList);        break;
+    }
+}
+
+bool MoveGen::isLegal(const Position& pos, Move move)
+{
+    return pos.SideToMove() == WHITE ? isLegalMove<WHITE>(pos, move) : isLegalMove<BLACK>(pos, move);
+}
+
+// Counts the legal moves with popcounts of the target bitboards instead of encoding and storing
+// every move. Free pieces count their whole target set at once, a pinned piece only keeps the
+// targets on the line through its king. Used for the last ply of perft, where only the number
+// of moves is needed.
+int MoveGen::count(const Position& pos)
+{
+    return pos.SideToMove() == WHITE ? countMoves<WHITE>(pos) : countMoves<BLACK>(pos);
+}
+
+namespace {  // anonymous namespace
+
+template<Color us, GenType genType>
+void generateMoves(const Position& pos, MoveList& moveList)
+{
+    generateKingMoves<us, genType>(pos, moveList);
 
     // Only king moves are legal if in double check
     if (moreThanOne(pos.Checkers()))
         return;
 
-    generatePawnMoves(pos, moveList, genType);
+    generatePawnMoves<us, genType>(pos, moveList);
+    generatePieceMoves<us, KNIGHT, genType>(pos, moveList);
+    generatePieceMoves<us, BISHOP, genType>(pos, moveList);
+    generatePieceMoves<us, ROOK,   genType>(pos, moveList);
+    generatePieceMoves<us, QUEEN,  genType>(pos, moveList);
+}
+
+template<Color us>
+bool isLegalMove(const Position& pos, Move move)
+{
+    Square from = getFromSquare(move);
+    Piece piece = pos.PieceOn(from);
+
+    if (move == MOVE_NONE || move == MOVE_NULL || piece == EMPTY || getColor(piece) != us)
+        return false;
+
+    // Only generate the moves of the moved piece type
+    MoveList moveList;
+    PieceType pt = getType(piece);
+
+    if (pt == KING)
+        generateKingMoves<us, ALL>(pos, moveList);
+
+    else if (moreThanOne(pos.Checkers()))
+        return false;
+
+    else switch (pt)
+    {
+        case PAWN:   generatePawnMoves<us, ALL>(pos, moveList);          break;
+        case KNIGHT: generatePieceMoves<us, KNIGHT, ALL>(pos, moveList); break;
+        case BISHOP: generatePieceMoves<us, BISHOP, ALL>(pos, moveList); break;
+        case ROOK:   generatePieceMoves<us, ROOK,   ALL>(pos, moveList); break;
+        case QUEEN:  generatePieceMoves<us, QUEEN,  ALL>(pos, moveList); break;
+        default:     return false;
+    }
+
+    for (int i = 0; i < moveList.count; i++)
+        if (moveList.moves[i].move == move)
+            return true;
 
-    for (PieceType pt : {KNIGHT, BISHOP, ROOK, QUEEN})
-        generatePieceMoves(pos, moveList, pt, genType);
+    return false;
 }
 
-namespace {  // anonymous namespace
+template<Color us>
+int countMoves(const Position& pos)
+{
+    constexpr Color them = ~us;
+
+    Square kingSq      = pos.KingSquare(us);
+    Bitboard checkers  = pos.Checkers();
+    Bitboard occupancy = pos.Pieces();
 
-void generateKingMoves(const Position& pos, MoveList& moveList, GenType genType)
+    // The king is removed so it cannot hide behind itself from a checking slider
+    Bitboard attacked = attackedBy<them>(pos, occupancy ^ kingSq);
+    int count = popCount(attackMask(KING, kingSq) & ~pos.Pieces(us) & ~attacked);
+
+    // Only king moves are legal if in double check
+    if (moreThanOne(checkers))
+        return count;
+
+    if (!checkers && canCastle(us, pos.CastlingRights()))
+    {
+        constexpr Bitboard shortMask  = (1ULL << relativeSquare(F1, us)) | (1ULL << relativeSquare(G1, us));
+        constexpr Bitboard longMask   = (1ULL << relativeSquare(B1, us)) | (1ULL << relativeSquare(C1, us)) | (1ULL << relativeSquare(D1, us));
+        constexpr Bitboard longSafe   = longMask & ~(1ULL << relativeSquare(B1, us));
+        constexpr uint8_t shortCastle = (us == WHITE ? WHITE_SHORT : BLACK_SHORT);
+        constexpr uint8_t longCastle  = (us == WHITE ? WHITE_LONG  : BLACK_LONG);
+
+        uint8_t cr = pos.CastlingRights();
+
+        if ((shortCastle & cr) && !(occupancy & shortMask) && !(attacked & shortMask))
+            count++;
+
+        if ((longCastle & cr) && !(occupancy & longMask) && !(attacked & longSafe))
+            count++;
+    }
+
+    Bitboard targets = legalSquares(pos);
+    Bitboard pinned  = pos.Pinned(us);
+
+    // A pinned knight can never move
+    Bitboard knights = pos.Pieces(KNIGHT, us) & ~pinned;
+
+    while (knights)
+        count += popCount(attackMask(KNIGHT, popSquare(knights)) & targets);
+
+    for (PieceType pt : {BISHOP, ROOK, QUEEN})
+    {
+        Bitboard pieces = pos.Pieces(pt, us);
+
+        while (pieces)
+        {
+            Square from      = popSquare(pieces);
+            Bitboard attacks = attackMask(pt, from, occupancy) & targets;
+
+            if (pinned & from)
+                attacks &= getLineMask(kingSq, from);
+
+            count += popCount(attacks);
+        }
+    }
+
+    return count + countPawnMoves<us>(pos, targets);
+}
+
+template<Color us, GenType genType>
+void generateKingMoves(const Position& pos, MoveList& moveList)
 {
-    Color us = pos.SideToMove();
-    Color them = ~us;
+    constexpr Color them = ~us;
 
     Square kingSq = pos.KingSquare(us);
     uint8_t cr = pos.CastlingRights();
     
     Bitboard kingMoves = attackMask(KING, kingSq) & ~pos.Pieces(us);
 
-    if (genType == CAPTURES)
+    if constexpr (genType == CAPTURES)
         kingMoves &= pos.Pieces(them);
 
+    else if constexpr (genType == QUIETS)
+        kingMoves &= ~pos.Pieces(them);
+
     while (kingMoves)
     {
         Square to = popSquare(kingMoves);
@@ -56,20 +202,23 @@ void generateKingMoves(const Position& pos, MoveList& moveList, GenType genType)
     }
 
     // Verify castling availability
-    if (pos.Checkers() || !canCastle(us, cr) || genType == CAPTURES)
+    if constexpr (genType == CAPTURES)
         return;
 
-    Bitboard b1 = getSquareMask(relativeSquare(B1, us));
-    Bitboard c1 = getSquareMask(relativeSquare(C1, us));
-    Bitboard d1 = getSquareMask(relativeSquare(D1, us));
-    Bitboard f1 = getSquareMask(relativeSquare(F1, us));
-    Bitboard g1 = getSquareMask(relativeSquare(G1, us));
+    if (pos.Checkers() || !canCastle(us, cr))
+        return;
 
-    Bitboard shortMask = f1 | g1;
-    Bitboard longMask  = b1 | c1 | d1;
+    constexpr Bitboard b1 = 1ULL << relativeSquare(B1, us);
+    constexpr Bitboard c1 = 1ULL << relativeSquare(C1, us);
+    constexpr Bitboard d1 = 1ULL << relativeSquare(D1, us);
+    constexpr Bitboard f1 = 1ULL << relativeSquare(F1, us);
+    constexpr Bitboard g1 = 1ULL << relativeSquare(G1, us);
 
-    uint8_t shortCastle = (us == WHITE ? WHITE_SHORT : BLACK_SHORT);
-    uint8_t longCastle  = (us == WHITE ? WHITE_LONG  : BLACK_LONG);
+    constexpr Bitboard shortMask = f1 | g1;
+    constexpr Bitboard longMask  = b1 | c1 | d1;
+
+    constexpr uint8_t shortCastle = (us == WHITE ? WHITE_SHORT : BLACK_SHORT);
+    constexpr uint8_t longCastle  = (us == WHITE ? WHITE_LONG  : BLACK_LONG);
 
     // Verify that short castle is legal
     if ((shortCastle & cr) && !(pos.Pieces() & shortMask) && pos.SquaresNotAttacked(shortMask, them))
@@ -80,15 +229,20 @@ void generateKingMoves(const Position& pos, MoveList& moveList, GenType genType)
         addMove(moveList, createMoveWithFlags(kingSq, relativeSquare(C1, us), CASTLING));
 }
 
-void generatePawnMoves(const Position& pos, MoveList& moveList, GenType genType)
+template<Color us, GenType genType>
+void generatePawnMoves(const Position& pos, MoveList& moveList)
 {
-    Color us = pos.SideToMove();
-    Color them = ~us;
+    constexpr Color them = ~us;
+
+    constexpr Bitboard doublePushRank = getRankMask(relativeRank(RANK_3, us));
+    constexpr Bitboard promotionRank  = getRankMask(relativeRank(RANK_7, us));
+
+    constexpr Direction up      = getPawnDir(us);
+    constexpr Direction upLeft  = (us == WHITE ? NORTH_WEST : SOUTH_EAST);
+    constexpr Direction upRight = (us == WHITE ? NORTH_EAST : SOUTH_WEST);
 
     Square kingSq = pos.KingSquare(us);
 
-    Bitboard doublePushRank = getRankMask(relativeRank(RANK_3, us));
-    Bitboard promotionRank  = getRankMask(relativeRank(RANK_7, us));
     Bitboard emptySquares   = ~pos.Pieces();
     Bitboard pawns          = pos.Pieces(PAWN, us) & ~promotionRank;
     Bitboard promoters      = pos.Pieces(PAWN, us) &  promotionRank;
@@ -98,12 +252,8 @@ void generatePawnMoves(const Position& pos, MoveList& moveList, GenType genType)
     Bitboard captureTargets = targets & enemies;
     Bitboard pinned         = pos.Pinned(us);
 
-    Direction up = getPawnDir(us);
-    Direction upLeft  = (us == WHITE ? NORTH_WEST : SOUTH_EAST);
-    Direction upRight = (us == WHITE ? NORTH_EAST : SOUTH_WEST);
-
     // Single and double pawn pushes
-    if (genType != CAPTURES)
+    if constexpr (genType != CAPTURES)
     {
         Bitboard singlePush = shift(pawns, up) & emptySquares;
         Bitboard doublePush = shift(singlePush & doublePushRank, up) & emptyTargets;
@@ -136,16 +286,13 @@ void generatePawnMoves(const Position& pos, MoveList& moveList, GenType genType)
         Bitboard capturesLeft  = shift(promoters, upLeft)  & captureTargets;
         Bitboard capturesRight = shift(promoters, upRight) & captureTargets;
 
-        if (genType == CAPTURES)
-            upPromoters = 0;
-
         while (upPromoters)
         {
             Square to = popSquare(upPromoters);
             Square from = to - up;
 
             if (!(pinned & from) || isAligned(from, to, kingSq))
-                addPromotionMoves(moveList, from, to);
+                addPromotionMoves<genType, false>(moveList, from, to);
         }
 
         while (capturesLeft)
@@ -154,7 +301,7 @@ void generatePawnMoves(const Position& pos, MoveList& moveList, GenType genType)
             Square from = to - upLeft;
 
             if (!(pinned & from) || isAligned(from, to, kingSq))
-                addPromotionMoves(moveList, from, to);
+                addPromotionMoves<genType, true>(moveList, from, to);
         }
 
         while (capturesRight)
@@ -163,11 +310,14 @@ void generatePawnMoves(const Position& pos, MoveList& moveList, GenType genType)
             Square from = to - upRight;
 
             if (!(pinned & from) || isAligned(from, to, kingSq))
-                addPromotionMoves(moveList, from, to);
+                addPromotionMoves<genType, true>(moveList, from, to);
         }
     }
 
     // Capture and en passant moves
+    if constexpr (genType == QUIETS)
+        return;
+
     if (!pawns)
         return;
 
@@ -220,27 +370,29 @@ void generatePawnMoves(const Position& pos, MoveList& moveList, GenType genType)
     }
 }
 
-void generatePieceMoves(const Position& pos, MoveList& moveList, PieceType pt, GenType genType)
+template<Color us, PieceType pt, GenType genType>
+void generatePieceMoves(const Position& pos, MoveList& moveList)
 {
-    Color us = pos.SideToMove();
-
     Bitboard pieces = pos.Pieces(pt, us);
 
     // If in check, only consider squares that resolves the check
     Bitboard possibleMoves = legalSquares(pos);
 
-    if (genType == CAPTURES)
+    if constexpr (genType == CAPTURES)
         possibleMoves &= pos.Pieces(~us);
 
+    else if constexpr (genType == QUIETS)
+        possibleMoves &= ~pos.Pieces(~us);
+
+    // A pinned knight can never move
+    if constexpr (pt == KNIGHT)
+        pieces &= ~pos.Pinned(us);
+
     while (pieces)
     {
         Square from      = popSquare(pieces);
         Bitboard attacks = attackMask(pt, from, pos.Pieces()) & possibleMoves;
-        bool pinned      = pos.Pinned(us) & from;
-
-        // A pinned knight can never move
-        if (pt == KNIGHT && pinned)
-            continue;
+        bool pinned      = (pt != KNIGHT) && (pos.Pinned(us) & from);
 
         while (attacks)
         {
@@ -252,17 +404,170 @@ void generatePieceMoves(const Position& pos, MoveList& moveList, PieceType pt, G
     }
 }
 
+// Generates all legal moves when the side to move is in check. The king escapes are checked against
+// one map of the enemy attacks, computed with the king removed so it cannot hide behind itself from a
+// slider. Other pieces can only capture the checker or block its line, so only the pieces that attack
+// one of those squares are considered.
+template<Color us>
+void generateEvasions(const Position& pos, MoveList& moveList)
+{
+    constexpr Color them = ~us;
+
+    Square kingSq     = pos.KingSquare(us);
+    Bitboard checkers = pos.Checkers();
+
+    Bitboard kingMoves = attackMask(KING, kingSq)
+                       & ~pos.Pieces(us)
+                       & ~attackedBy<them>(pos, pos.Pieces() ^ kingSq);
+
+    while (kingMoves)
+        addMove(moveList, createMove(kingSq, popSquare(kingMoves)));
+
+    // Only king moves are legal if in double check
+    if (moreThanOne(checkers))
+        return;
+
+    // The checker and the squares between it and the king
+    Bitboard targets   = getBetweenMask(kingSq, firstSquare(checkers));
+    Bitboard pinned    = pos.Pinned(us);
+    Bitboard occupancy = pos.Pieces();
+
+    while (targets)
+    {
+        Square to = popSquare(targets);
+
+        Bitboard reaching = (  (attackMask(KNIGHT, to)            & pos.Pieces(KNIGHT))
+                             | (attackMask(BISHOP, to, occupancy) & pos.Pieces(BISHOP, QUEEN))
+                             | (attackMask(ROOK,   to, occupancy) & pos.Pieces(ROOK,   QUEEN)))
+                          & pos.Pieces(us);
+
+        while (reaching)
+        {
+            Square from = popSquare(reaching);
+
+            if (!(pinned & from) || isAligned(from, to, kingSq))
+                addMove(moveList, createMove(from, to));
+        }
+    }
+
+    generatePawnMoves<us, EVASIONS>(pos, moveList);
+}
+
+// Counts the legal pawn moves onto the given targets. The free pawns are shifted as one set,
+// the pinned pawns one at a time along their pin line, and every promotion counts four times.
+template<Color us>
+int countPawnMoves(const Position& pos, Bitboard targets)
+{
+    constexpr Color them = ~us;
+
+    constexpr Bitboard doublePushRank = getRankMask(relativeRank(RANK_3, us));
+    constexpr Bitboard promotionRank  = getRankMask(relativeRank(RANK_8, us));
+
+    constexpr Direction up      = getPawnDir(us);
+    constexpr Direction upLeft  = (us == WHITE ? NORTH_WEST : SOUTH_EAST);
+    constexpr Direction upRight = (us == WHITE ? NORTH_EAST : SOUTH_WEST);
+
+    Square kingSq = pos.KingSquare(us);
+
+    Bitboard emptySquares   = ~pos.Pieces();
+    Bitboard enemies        = pos.Pieces(them);
+    Bitboard pawns          = pos.Pieces(PAWN, us);
+    Bitboard pinned         = pawns & pos.Pinned(us);
+
+    int count = 0;
+
+    // Counts the moves of the given pawns onto the allowed targets
+    auto countMoves = [&](Bitboard from, Bitboard allowed) {
+        Bitboard mask       = targets & allowed;
+        Bitboard singlePush = shift(from, up) & emptySquares;
+        Bitboard doublePush = shift(singlePush & doublePushRank, up) & emptySquares;
+        int moves = 0;
+
+        for (Bitboard b : {singlePush & mask,
+                           doublePush & mask,
+                           shift(from, upLeft)  & enemies & mask,
+                           shift(from, upRight) & enemies & mask})
+            moves += popCount(b & ~promotionRank) + 4 * popCount(b & promotionRank);
+
+        return moves;
+    };
+
+    count += countMoves(pawns & ~pinned, ~0ULL);
+
+    while (pinned)
+    {
+        Square from = popSquare(pinned);
+        count += countMoves(getSquareMask(from), getLineMask(kingSq, from));
+    }
+
+    // en passant captures
+    Square epSq = pos.EnpassantSquare();
+
+    if (epSq == NO_SQUARE)
+        return count;
+
+    Bitboard epAttackers = pawnAttackMask(them, epSq) & pawns;
+
+    while (epAttackers)
+    {
+        Square from = popSquare(epAttackers);
+
+        // Blockers represent the position after the en passant move is made
+        Bitboard blockers = (pos.Pieces() ^ from ^ (epSq - up)) | epSq;
+
+        bool rookAttacked   = attackMask(ROOK,   kingSq, blockers) & pos.Pieces(ROOK,   QUEEN) & pos.Pieces(them);
+        bool bishopAttacked = attackMask(BISHOP, kingSq, blockers) & pos.Pieces(BISHOP, QUEEN) & pos.Pieces(them);
+
+        if (!rookAttacked && !bishopAttacked)
+            count++;
+    }
+
+    return count;
+}
+
+// Returns the squares attacked by the given side with the given occupancy
+template<Color color>
+inline Bitboard attackedBy(const Position& pos, Bitboard occupancy)
+{
+    Bitboard pawns   = pos.Pieces(PAWN, color);
+    Bitboard knights = pos.Pieces(KNIGHT, color);
+    Bitboard bishops = pos.Pieces(BISHOP, QUEEN) & pos.Pieces(color);
+    Bitboard rooks   = pos.Pieces(ROOK,   QUEEN) & pos.Pieces(color);
+
+    Bitboard attacks = (color == WHITE ? shift(pawns, NORTH_WEST) | shift(pawns, NORTH_EAST)
+                                       : shift(pawns, SOUTH_WEST) | shift(pawns, SOUTH_EAST));
+
+    attacks |= attackMask(KING, pos.KingSquare(color));
+
+    while (knights)
+        attacks |= attackMask(KNIGHT, popSquare(knights));
+
+    while (bishops)
+        attacks |= attackMask(BISHOP, popSquare(bishops), occupancy);
+
+    while (rooks)
+        attacks |= attackMask(ROOK, popSquare(rooks), occupancy);
+
+    return attacks;
+}
+
 inline void addMove(MoveList& moveList, Move move)
 {
     moveList.moves[moveList.count].move = move;
     moveList.count++;
 }
 
-// Includes underpromotion
+// Queen promotions and every promotion that captures count as captures,
+// only the underpromotions that do not capture are quiet moves
+template<GenType genType, bool capture>
 inline void addPromotionMoves(MoveList& moveList, Square from, Square to)
 {
-    for (PieceType pt : {KNIGHT, BISHOP, ROOK, QUEEN})
-        addMove(moveList, createMoveWithFlags(from, to, PROMOTION, pt));
+    if constexpr (genType != QUIETS)
+        addMove(moveList, createMoveWithFlags(from, to, PROMOTION, QUEEN));
+
+    if constexpr (capture ? genType != QUIETS : genType != CAPTURES)
+        for (PieceType pt : {KNIGHT, BISHOP, ROOK})
+            addMove(moveList, createMoveWithFlags(from, to, PROMOTION, pt));
 }
 
 // If in check, returns the squares that resolves the check,
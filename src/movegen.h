@@ -31,6 +31,13 @@ namespace MoveGen {
 // Generates all the legal moves for the given position and populates the given moveList
 void generate(const Position& pos, MoveList& moveList, GenType genType = ALL);
 
+// Returns the number of legal moves in the given position without generating them
+int count(const Position& pos);
+
+// Checks if the move is legal in the given position. Used to verify moves that
+// come from the hash table or from other positions before they are searched
+bool isLegal(const Position& pos, Move move);
+
 } // namespace MoveGen
 
 } // namespace ChessEngine
@@ -0,0 +1,165 @@
+#include <utility>
+
+#include "movepick.h"
+
+namespace ChessEngine {
+
+MovePicker::MovePicker(const Position& pos, Move ttMove, const Move killers[2], const ButterflyHistory& history)
+    : pos(pos), history(history), ttMove(ttMove), killers{killers[0], killers[1]},
+      stage(STAGE_TT_MOVE), current(0), killerIndex(0), numBadCaptures(0), capturesOnly(false)
+{
+    moveList.count = 0;
+}
+
+MovePicker::MovePicker(const Position& pos, Move ttMove, const ButterflyHistory& history)
+    : pos(pos), history(history), ttMove(ttMove), killers{MOVE_NONE, MOVE_NONE},
+      stage(STAGE_TT_MOVE), current(0), killerIndex(0), numBadCaptures(0), capturesOnly(!pos.Checkers())
+{
+    moveList.count = 0;
+}
+
+Move MovePicker::NextMove()
+{
+    switch (stage)
+    {
+        case STAGE_TT_MOVE:
+            stage++;
+
+            // The hash move may come from another position that shares the hash bucket
+            if (   ttMove != MOVE_NONE
+                && (!capturesOnly || !isQuiet(pos, ttMove))
+                && MoveGen::isLegal(pos, ttMove))
+                return ttMove;
+
+            ttMove = MOVE_NONE;
+            [[fallthrough]];
+
+        case STAGE_CAPTURE_INIT:
+            MoveGen::generate(pos, moveList, CAPTURES);
+            ScoreCaptures();
+            current = 0;
+            stage++;
+            [[fallthrough]];
+
+        case STAGE_CAPTURES:
+            while (current < moveList.count)
+            {
+                Move move = PickBest();
+
+                if (move == ttMove)
+                    continue;
+
+                // The quiescence search prunes the losing captures itself, the main
+                // search tries them after the quiets. They are kept at the front of
+                // the list, which the selection sort has already passed.
+                if (!capturesOnly && !pos.SEE_GE(move))
+                {
+                    moveList.moves[numBadCaptures++].move = move;
+                    continue;
+                }
+
+                return move;
+            }
+
+            if (capturesOnly)
+            {
+                stage = STAGE_DONE;
+                return MOVE_NONE;
+            }
+
+            stage++;
+            [[fallthrough]];
+
+        case STAGE_KILLERS:
+            while (killerIndex < 2)
+            {
+                Move killer = killers[killerIndex++];
+
+                // Killers come from sibling nodes and must be verified in this position
+                if (   killer != MOVE_NONE
+                    && killer != ttMove
+                    && isQuiet(pos, killer)
+                    && MoveGen::isLegal(pos, killer))
+                    return killer;
+            }
+
+            stage++;
+            [[fallthrough]];
+
+        case STAGE_QUIET_INIT:
+            moveList.count = numBadCaptures;
+            MoveGen::generate(pos, moveList, QUIETS);
+            ScoreQuiets();
+            current = numBadCaptures;
+            stage++;
+            [[fallthrough]];
+
+        case STAGE_QUIETS:
+            while (current < moveList.count)
+            {
+                Move move = PickBest();
+
+                if (move != ttMove && move != killers[0] && move != killers[1])
+                    return move;
+            }
+
+            current = 0;
+            stage++;
+            [[fallthrough]];
+
+        case STAGE_BAD_CAPTURES:
+            if (current < numBadCaptures)
+                return moveList.moves[current++].move;
+
+            stage++;
+            [[fallthrough]];
+
+        case STAGE_DONE:
+            return MOVE_NONE;
+    }
+
+    return MOVE_NONE;
+}
+
+// Most valuable victim, least valuable attacker
+void MovePicker::ScoreCaptures()
+{
+    for (int i = 0; i < moveList.count; i++)
+    {
+        Move move = moveList.moves[i].move;
+        Square to = getToSquare(move);
+
+        PieceType victim   = (getMoveType(move) == EN_PASSANT ? PAWN : getType(pos.PieceOn(to)));
+        PieceType attacker = getType(pos.PieceOn(getFromSquare(move)));
+
+        moveList.moves[i].score = 8 * PieceValue[victim] - PieceValue[attacker];
+
+        if (getMoveType(move) == PROMOTION)
+            moveList.moves[i].score += PieceValue[getPromotionType(move)];
+    }
+}
+
+void MovePicker::ScoreQuiets()
+{
+    Color us = pos.SideToMove();
+
+    for (int i = numBadCaptures; i < moveList.count; i++)
+        moveList.moves[i].score = history.Get(us, moveList.moves[i].move);
+}
+
+// One step of a selection sort, so only the moves that are actually
+// searched get sorted before a cutoff ends the node
+Move MovePicker::PickBest()
+{
+    int best = current;
+
+    for (int i = current + 1; i < moveList.count; i++)
+        if (moveList.moves[i].score > moveList.moves[best].score)
+            best = i;
+
+    std::swap(moveList.moves[current], moveList.moves[best]);
+
+    return moveList.moves[current++].move;
+}
+
+} // namespace ChessEngine
@@ -0,0 +1,93 @@
+#ifndef MOVEPICK_INCLUDED
+#define MOVEPICK_INCLUDED
+
+#include <cstdlib>
+
+#include "defs.h"
+#include "movegen.h"
+#include "position.h"
+
+namespace ChessEngine {
+
+// Scores of the quiet moves by how often they caused a cutoff, indexed by the side to move,
+// the source and the target square. See: https://www.chessprogramming.org/History_Heuristic
+struct ButterflyHistory
+{
+    static constexpr int MAX_VALUE = 16384;
+
+    inline int Get(Color color, Move move) const
+    {
+        return table[color][getFromSquare(move)][getToSquare(move)];
+    }
+
+    // Moves the entry towards +-MAX_VALUE, the closer it already is the smaller the step
+    inline void Update(Color color, Move move, int bonus)
+    {
+        int& entry = table[color][getFromSquare(move)][getToSquare(move)];
+        entry += bonus - entry * std::abs(bonus) / MAX_VALUE;
+    }
+
+    int table[NUM_COLORS][NUM_SQUARES][NUM_SQUARES];
+};
+
+// Captures and queen promotions are searched in the capture stage, everything else is quiet
+inline bool isQuiet(const Position& pos, Move move)
+{
+    return   !pos.IsCapture(move)
+          && !(getMoveType(move) == PROMOTION && getPromotionType(move) == QUEEN);
+}
+
+// Hands out the legal moves of a position one at a time, best first, in stages: the hash move,
+// the captures ordered by MVV-LVA, the killer moves, the quiet moves ordered by history and
+// last the captures that lose material by the static exchange evaluation.
+// A stage is only generated once the previous one runs out, so a node that cuts off early
+// never pays for generating and scoring the moves it does not search.
+class MovePicker {
+public:
+    MovePicker(const Position& pos, Move ttMove, const Move killers[2], const ButterflyHistory& history);
+
+    // Quiescence search, only the hash move and the captures unless the side to move is in check
+    MovePicker(const Position& pos, Move ttMove, const ButterflyHistory& history);
+    MovePicker(const MovePicker&) = delete;
+
+    // Returns MOVE_NONE when all moves have been handed out
+    Move NextMove();
+
+    inline bool GeneratedCaptures() const { return stage > STAGE_CAPTURE_INIT; }
+    inline bool GeneratedQuiets()   const { return stage > STAGE_QUIET_INIT; }
+
+    // Whether the move handed out last is a capture with a negative static exchange evaluation
+    inline bool BadCapture()        const { return stage == STAGE_BAD_CAPTURES; }
+
+private:
+    enum Stage
+    {
+        STAGE_TT_MOVE,
+        STAGE_CAPTURE_INIT,
+        STAGE_CAPTURES,
+        STAGE_KILLERS,
+        STAGE_QUIET_INIT,
+        STAGE_QUIETS,
+        STAGE_BAD_CAPTURES,
+        STAGE_DONE
+    };
+
+    void ScoreCaptures();
+    void ScoreQuiets();
+    Move PickBest();
+
+    const Position& pos;
+    const ButterflyHistory& history;
+    Move ttMove;
+    Move killers[2];
+    int stage;
+    int current;
+    int killerIndex;
+    int numBadCaptures;
+    bool capturesOnly;
+    MoveList moveList;
+};
+
+} // namespace ChessEngine
+
+#endif // MOVEPICK_INCLUDED
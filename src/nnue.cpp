@@ -0,0 +1,329 @@
+#include <algorithm>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "nnue.h"
+#include "misc.h"
+#include "position.h"
+
+namespace ChessEngine {
+
+namespace NNUE {
+
+namespace {  // anonymous namespace
+
+// The king bucket of every square from the own side, the king's own half of the board is split
+// finer as the piece placement matters more around a castled king than around an active one
+constexpr int KingBucket[NUM_SQUARES] = {
+    0, 0, 1, 1, 2, 2, 3, 3,
+    0, 0, 1, 1, 2, 2, 3, 3,
+    4, 4, 4, 4, 5, 5, 5, 5,
+    4, 4, 4, 4, 5, 5, 5, 5,
+    6, 6, 6, 6, 7, 7, 7, 7,
+    6, 6, 6, 6, 7, 7, 7, 7,
+    6, 6, 6, 6, 7, 7, 7, 7,
+    6, 6, 6, 6, 7, 7, 7, 7,
+};
+
+// A longer chain of uncomputed accumulators is cheaper to refresh than to update
+constexpr int MAX_UPDATE_PLIES = 8;
+
+// Black sees the board mirrored, so both sides share the same weights
+constexpr Square orient(Color perspective, Square square)
+{
+    return Square(square ^ (perspective * 56));
+}
+
+constexpr int kingBucket(Color perspective, Square kingSquare)
+{
+    return KingBucket[orient(perspective, kingSquare)];
+}
+
+constexpr int featureIndex(Color perspective, int bucket, Piece piece, Square square)
+{
+    return bucket * 12 * NUM_SQUARES
+         + ((getColor(piece) != perspective) * 6 + getType(piece) - PAWN) * NUM_SQUARES
+         + orient(perspective, square);
+}
+
+// The loaded network, the pointers lead into the memory mapped file
+struct Network
+{
+    const int16_t* featureBiases;
+    const int16_t* featureWeights;
+    const int16_t* outputWeights;
+    int32_t outputBias;
+
+    void* data;
+    size_t size;
+};
+
+Network network = {};
+
+void release(Network& net)
+{
+    if (!net.data)
+        return;
+
+    unmapFile(net.data, net.size);
+
+    net = {};
+}
+
+// The SIMD kernels work on one accumulator half of L1_SIZE int16 values. With AVX2 it is
+// 16 registers wide, which are all kept in registers while the weight columns are added.
+#if defined(__AVX2__)
+
+constexpr int REGISTER_WIDTH = 16;
+constexpr int NUM_REGISTERS  = L1_SIZE / REGISTER_WIDTH;
+
+// out = in + the sum of the added columns - the sum of the removed columns
+void updateColumns(int16_t* out, const int16_t* in, const int* added, int numAdded, const int* removed, int numRemoved)
+{
+    __m256i regs[NUM_REGISTERS];
+
+    for (int i = 0; i < NUM_REGISTERS; i++)
+        regs[i] = _mm256_load_si256(reinterpret_cast<const __m256i*>(in) + i);
+
+    for (int j = 0; j < numRemoved; j++)
+    {
+        const __m256i* column = reinterpret_cast<const __m256i*>(&network.featureWeights[size_t(removed[j]) * L1_SIZE]);
+
+        for (int i = 0; i < NUM_REGISTERS; i++)
+            regs[i] = _mm256_sub_epi16(regs[i], _mm256_load_si256(column + i));
+    }
+
+    for (int j = 0; j < numAdded; j++)
+    {
+        const __m256i* column = reinterpret_cast<const __m256i*>(&network.featureWeights[size_t(added[j]) * L1_SIZE]);
+
+        for (int i = 0; i < NUM_REGISTERS; i++)
+            regs[i] = _mm256_add_epi16(regs[i], _mm256_load_si256(column + i));
+    }
+
+    for (int i = 0; i < NUM_REGISTERS; i++)
+        _mm256_store_si256(reinterpret_cast<__m256i*>(out) + i, regs[i]);
+}
+
+// The sum of the clipped accumulator values times the output weights
+int32_t dotClipped(const int16_t* values, const int16_t* weights)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i qa   = _mm256_set1_epi16(QA);
+    __m256i sum = _mm256_setzero_si256();
+
+    for (int i = 0; i < NUM_REGISTERS; i++)
+    {
+        __m256i v = _mm256_load_si256(reinterpret_cast<const __m256i*>(values) + i);
+        __m256i w = _mm256_load_si256(reinterpret_cast<const __m256i*>(weights) + i);
+
+        v = _mm256_min_epi16(_mm256_max_epi16(v, zero), qa);
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(v, w));
+    }
+
+    __m128i sum128 = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    sum128 = _mm_add_epi32(sum128, _mm_shuffle_epi32(sum128, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum128 = _mm_add_epi32(sum128, _mm_shuffle_epi32(sum128, _MM_SHUFFLE(2, 3, 0, 1)));
+
+    return _mm_cvtsi128_si32(sum128);
+}
+
+#else
+
+void updateColumns(int16_t* out, const int16_t* in, const int* added, int numAdded, const int* removed, int numRemoved)
+{
+    std::memcpy(out, in, sizeof(int16_t) * L1_SIZE);
+
+    for (int j = 0; j < numRemoved; j++)
+    {
+        const int16_t* column = &network.featureWeights[size_t(removed[j]) * L1_SIZE];
+
+        for (int i = 0; i < L1_SIZE; i++)
+            out[i] -= column[i];
+    }
+
+    for (int j = 0; j < numAdded; j++)
+    {
+        const int16_t* column = &network.featureWeights[size_t(added[j]) * L1_SIZE];
+
+        for (int i = 0; i < L1_SIZE; i++)
+            out[i] += column[i];
+    }
+}
+
+int32_t dotClipped(const int16_t* values, const int16_t* weights)
+{
+    int32_t sum = 0;
+
+    for (int i = 0; i < L1_SIZE; i++)
+        sum += std::clamp<int>(values[i], 0, QA) * weights[i];
+
+    return sum;
+}
+
+#endif
+
+// Computes one half of the accumulator from the biases and the columns of all pieces on the board
+void refresh(const Position& pos, Color perspective, Accumulator& acc)
+{
+    int active[32];
+    int numActive = 0;
+    int bucket = kingBucket(perspective, pos.KingSquare(perspective));
+    Bitboard pieces = pos.Pieces();
+
+    while (pieces)
+    {
+        Square square = popSquare(pieces);
+        active[numActive++] = featureIndex(perspective, bucket, pos.PieceOn(square), square);
+    }
+
+    updateColumns(acc.values[perspective], network.featureBiases, active, numActive, nullptr, 0);
+    acc.computed[perspective] = true;
+}
+
+// A king moving to another bucket changes the index of every feature of its side
+bool needsRefresh(const DirtyPiece& dp, Color perspective)
+{
+    for (int i = 0; i < dp.count; i++)
+        if (   dp.piece[i] == getPiece(KING, perspective)
+            && kingBucket(perspective, dp.from[i]) != kingBucket(perspective, dp.to[i]))
+            return true;
+
+    return false;
+}
+
+// Finds the closest ply with a computed accumulator and applies the dirty pieces of every
+// ply after it, filling the accumulators along the way so the siblings can start from them.
+// The walk ends at a root, which has no dirty pieces and no accumulator to start from.
+void update(const Position& pos, Color perspective)
+{
+    PosInfo* plies[MAX_UPDATE_PLIES];
+    PosInfo* info = pos.Info();
+    int numPlies = 0;
+
+    while (!info->accumulator.computed[perspective])
+    {
+        if (!info->dirtyPiece.count || numPlies == MAX_UPDATE_PLIES || needsRefresh(info->dirtyPiece, perspective))
+        {
+            refresh(pos, perspective, pos.Info()->accumulator);
+            return;
+        }
+
+        plies[numPlies++] = info;
+        info = info->prev;
+    }
+
+    int bucket = kingBucket(perspective, pos.KingSquare(perspective));
+
+    while (numPlies--)
+    {
+        PosInfo* next = plies[numPlies];
+        const DirtyPiece& dp = next->dirtyPiece;
+        int added[4], removed[4];
+        int numAdded = 0, numRemoved = 0;
+
+        for (int i = 0; i < dp.count; i++)
+        {
+            if (dp.from[i] != NO_SQUARE)
+                removed[numRemoved++] = featureIndex(perspective, bucket, dp.piece[i], dp.from[i]);
+
+            if (dp.to[i] != NO_SQUARE)
+                added[numAdded++] = featureIndex(perspective, bucket, dp.piece[i], dp.to[i]);
+        }
+
+        updateColumns(next->accumulator.values[perspective], info->accumulator.values[perspective],
+                      added, numAdded, removed, numRemoved);
+        next->accumulator.computed[perspective] = true;
+        info = next;
+    }
+}
+
+int output(const Accumulator& acc, Color sideToMove)
+{
+    int32_t sum = network.outputBias
+                + dotClipped(acc.values[ sideToMove], network.outputWeights)
+                + dotClipped(acc.values[~sideToMove], network.outputWeights + L1_SIZE);
+
+    return int(int64_t(sum) * SCALE / (QA * QB));
+}
+
+} // anonymous namespace
+
+// Maps the file and checks that it holds a network of this architecture
+bool load(const std::string& path)
+{
+    Network net = {};
+
+    if (!(net.data = mapFile(path, net.size)))
+        return false;
+
+    const FileHeader* header = static_cast<const FileHeader*>(net.data);
+
+    if (   net.size != FILE_SIZE
+        || std::memcmp(header->magic, FILE_MAGIC, sizeof(FILE_MAGIC))
+        || header->version     != FILE_VERSION
+        || header->numFeatures != uint32_t(NUM_FEATURES)
+        || header->l1Size      != uint32_t(L1_SIZE))
+    {
+        release(net);
+        return false;
+    }
+
+    const int16_t* weights = reinterpret_cast<const int16_t*>(header + 1);
+
+    net.featureBiases  = weights;
+    net.featureWeights = net.featureBiases  + L1_SIZE;
+    net.outputWeights  = net.featureWeights + size_t(NUM_FEATURES) * L1_SIZE;
+    std::memcpy(&net.outputBias, net.outputWeights + 2 * L1_SIZE, sizeof(int32_t));
+
+    release(network);
+    network = net;
+
+    return true;
+}
+
+bool isLoaded()
+{
+    return network.data != nullptr;
+}
+
+int evaluate(const Position& pos)
+{
+    assert(isLoaded());
+
+    Accumulator& acc = pos.Info()->accumulator;
+
+    for (Color perspective : { WHITE, BLACK })
+        if (!acc.computed[perspective])
+            update(pos, perspective);
+
+    return output(acc, pos.SideToMove());
+}
+
+int evaluateRefresh(const Position& pos)
+{
+    assert(isLoaded());
+
+    Accumulator acc;
+
+    refresh(pos, WHITE, acc);
+    refresh(pos, BLACK, acc);
+
+    return output(acc, pos.SideToMove());
+}
+
+const char* simdName()
+{
+#if defined(__AVX2__)
+    return "AVX2";
+#else
+    return "scalar";
+#endif
+}
+
+} // namespace NNUE
+
+} // namespace ChessEngine
@@ -0,0 +1,96 @@
+#ifndef NNUE_INCLUDED
+#define NNUE_INCLUDED
+
+#include <string>
+
+#include "defs.h"
+
+namespace ChessEngine {
+
+class Position;
+
+namespace NNUE {
+
+// The network is a king bucketed feature transformer into L1_SIZE neurons for each side,
+// followed by a clipped ReLU and a single output neuron over both halves, side to move first.
+// A feature is a piece on a square, seen from one side with its king in one of the buckets.
+constexpr int NUM_KING_BUCKETS = 8;
+constexpr int NUM_FEATURES     = NUM_KING_BUCKETS * 12 * NUM_SQUARES;
+constexpr int L1_SIZE          = 256;
+
+// Quantization of the clipped ReLU, the output weights and the final scale to centipawns
+constexpr int QA    = 255;
+constexpr int QB    = 64;
+constexpr int SCALE = 400;
+
+// The weights file is the header followed by the feature transformer biases and weights, the
+// output weights and the output bias, all little endian and 64 byte aligned so that the SIMD
+// kernels can work directly on the memory mapped file:
+//
+//     int16_t featureBiases[L1_SIZE]
+//     int16_t featureWeights[NUM_FEATURES][L1_SIZE]
+//     int16_t outputWeights[2 * L1_SIZE]
+//     int32_t outputBias
+struct FileHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t numFeatures;
+    uint32_t l1Size;
+    uint32_t reserved[12];
+};
+
+constexpr char FILE_MAGIC[4]   = {'C', 'E', 'N', 'N'};
+constexpr uint32_t FILE_VERSION = 1;
+constexpr size_t FILE_SIZE      = sizeof(FileHeader)
+                                + sizeof(int16_t) * (L1_SIZE + size_t(NUM_FEATURES) * L1_SIZE + 2 * L1_SIZE)
+                                + sizeof(int32_t);
+
+constexpr const char* DEFAULT_FILE = "network.nnue";
+
+// The pieces that changed with the last move: moved pieces have both squares,
+// captured pieces no "to" and the piece a pawn promotes to no "from" square
+struct DirtyPiece
+{
+    int count;
+    Piece piece[4];
+    Square from[4];
+    Square to[4];
+
+    void add(Piece pc, Square fromSq, Square toSq)
+    {
+        assert(count < 4);
+        piece[count] = pc;
+        from[count]  = fromSq;
+        to[count]    = toSq;
+        count++;
+    }
+};
+
+// The output of the feature transformer for both sides, kept for every ply in the PosInfo.
+// Filled on first evaluation from the one of the previous ply and the dirty pieces.
+struct alignas(32) Accumulator
+{
+    int16_t values[NUM_COLORS][L1_SIZE];
+    bool computed[NUM_COLORS];
+};
+
+// Memory maps the weights file, returns false and keeps the previous network if it is invalid
+bool load(const std::string& path);
+bool isLoaded();
+
+// Returns the evaluation of the position from the side to move's point of view.
+// The accumulators are updated incrementally if possible
+int evaluate(const Position& pos);
+
+// Same as evaluate, but always computes the accumulators from scratch
+int evaluateRefresh(const Position& pos);
+
+// The name of the SIMD kernels the binary was compiled with
+const char* simdName();
+
+} // namespace NNUE
+
+} // namespace ChessEngine
+
+#endif // NNUE_INCLUDED
@@ -0,0 +1,113 @@
+#include <algorithm>
+
+#include "pawns.h"
+#include "position.h"
+
+namespace ChessEngine {
+
+namespace {  // anonymous namespace
+
+constexpr Score Doubled  = {-10, -20};
+constexpr Score Isolated = { -8, -12};
+constexpr Score Backward = { -6, -10};
+
+// Indexed by the rank of the passed pawn relative to its side
+constexpr Score PassedRank[NUM_RANKS] = {
+    {0, 0}, {5, 10}, {5, 15}, {10, 25}, {20, 40}, {35, 70}, {60, 110}, {0, 0}
+};
+
+// The shelter of the king by its pawn on each of the files around it
+constexpr int ShieldRank2 = 10;
+constexpr int ShieldRank3 = 5;
+constexpr int OpenFile    = -15;
+
+template<Color us>
+void evaluate(const Position& pos, Pawns::Entry* entry)
+{
+    constexpr Color them = ~us;
+    constexpr Direction up = getPawnDir(us);
+
+    Bitboard ourPawns   = pos.Pieces(PAWN, us);
+    Bitboard theirPawns = pos.Pieces(PAWN, them);
+    Bitboard pawns      = ourPawns;
+    Score score = {0, 0};
+
+    entry->passedPawns[us] = 0;
+
+    while (pawns)
+    {
+        Square sq = popSquare(pawns);
+        Rank rank = relativeRank(getRank(sq), us);
+
+        bool doubled  = ourPawns & getForwardFileMask(us, sq);
+        bool isolated = !(ourPawns & getAdjacentFilesMask(getFile(sq)));
+        bool passed   = !(theirPawns & getPassedPawnMask(us, sq));
+
+        // No pawn beside or behind it on the adjacent files can defend it when
+        // it advances, and an enemy pawn already controls its stop square
+        bool backward =   !isolated
+                       && !(ourPawns & getPawnAttackSpan(them, sq + up))
+                       &&  (theirPawns & pawnAttackMask(us, sq + up));
+
+        if (doubled)
+            score += Doubled;
+
+        if (isolated)
+            score += Isolated;
+
+        else if (backward)
+            score += Backward;
+
+        // Only the front pawn of doubled pawns counts as passed
+        if (passed && !doubled)
+        {
+            entry->passedPawns[us] |= sq;
+            score += PassedRank[rank];
+        }
+    }
+
+    entry->scores[us] = score;
+
+    Bitboard shieldRanks[2] = { getRankMask(relativeRank(RANK_2, us)), getRankMask(relativeRank(RANK_3, us)) };
+
+    for (File kingFile = FILE_A; kingFile < NUM_FILES; kingFile++)
+    {
+        int shelter = 0;
+
+        for (File file = std::max(FILE_A, File(kingFile - 1)); file <= std::min(FILE_H, File(kingFile + 1)); file++)
+        {
+            Bitboard filePawns = ourPawns & (FileAMask << file);
+
+            shelter += (filePawns & shieldRanks[0]) ? ShieldRank2
+                     : (filePawns & shieldRanks[1]) ? ShieldRank3
+                     : !filePawns                   ? OpenFile
+                                                    : 0;
+        }
+
+        entry->shelter[us][kingFile] = int16_t(shelter);
+    }
+}
+
+} // anonymous namespace
+
+Pawns::Entry* Pawns::probe(const Position& pos, Table& table)
+{
+    Key key = pos.PawnKey();
+    Entry* entry = table[key];
+
+    table.probes++;
+
+    if (entry->key == key)
+    {
+        table.hits++;
+        return entry;
+    }
+
+    entry->key = key;
+    evaluate<WHITE>(pos, entry);
+    evaluate<BLACK>(pos, entry);
+
+    return entry;
+}
+
+} // namespace ChessEngine
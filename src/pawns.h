@@ -0,0 +1,42 @@
+#ifndef PAWNS_INCLUDED
+#define PAWNS_INCLUDED
+
+#include "defs.h"
+
+namespace ChessEngine {
+
+class Position;
+
+namespace Pawns {
+
+// The evaluation of a pawn structure, which only depends on the pawns. The king shelter is
+// kept for a king on every file, so that the king can move without changing the entry.
+struct Entry
+{
+    Key key;
+    Score scores[NUM_COLORS];
+    Bitboard passedPawns[NUM_COLORS];
+    int16_t shelter[NUM_COLORS][NUM_FILES];
+};
+
+// A small hash table of pawn structures, owned by each search thread so it needs no locking.
+// The pawn structure changes in few of the moves, so most probes are hits.
+struct Table
+{
+    static constexpr size_t SIZE = 16384;
+
+    inline Entry* operator[](Key key) { return &entries[key & (SIZE - 1)]; }
+
+    Entry entries[SIZE];
+    uint64_t probes;
+    uint64_t hits;
+};
+
+// Returns the entry of the pawn structure of the position, evaluating it on a miss
+Entry* probe(const Position& pos, Table& table);
+
+} // namespace Pawns
+
+} // namespace ChessEngine
+
+#endif // PAWNS_INCLUDED
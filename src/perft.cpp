@@ -1,8 +1,16 @@
 #include <iostream>
 #include <chrono>
+#include <atomic>
+#include <memory>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <algorithm>
 
 #include "perft.h"
 #include "movegen.h"
+#include "uci.h"
 
 namespace ChessEngine {
 
@@ -10,20 +18,104 @@ namespace Perft {
 
 namespace {  // anonymous namespace
 
+// A lockless hash table of node counts keyed by the position key and the remaining depth.
+// Like the transposition table, each entry stores the key XORed with its data so that
+// threads sharing the cache never read a count that was torn by a concurrent write.
+class Cache {
+public:
+    void Resize(size_t megabytes);
+    void Clear();
+
+    bool Probe(Key key, int depth, uint64_t& nodes);
+    void Store(Key key, int depth, uint64_t nodes);
+
+    inline bool Enabled() const { return numBuckets != 0; }
+    inline CacheStats Stats() const { return { probes.load(std::memory_order_relaxed), hits.load(std::memory_order_relaxed) }; }
+
+private:
+    // The data word holds the depth in the 8 MSB and the node count in the rest
+    static constexpr int DEPTH_SHIFT = 56;
+    static constexpr uint64_t NODES_MASK = (1ULL << DEPTH_SHIFT) - 1;
+
+    struct Entry
+    {
+        std::atomic<uint64_t> keyXorData;
+        std::atomic<uint64_t> data;
+    };
+
+    struct alignas(64) Bucket
+    {
+        Entry entries[4];
+    };
+
+    // Different depths of the same position land in different buckets
+    inline Bucket& GetBucket(Key key, int depth)
+    {
+        return table[(key ^ (depth * 0x9E3779B97F4A7C15ULL)) % numBuckets];
+    }
+
+    std::unique_ptr<Bucket[]> table;
+    size_t numBuckets = 0;
+    std::atomic<uint64_t> probes{0};
+    std::atomic<uint64_t> hits{0};
+};
+
+Cache cache;
+
+// The parallel perft splits the tree this many plies below the root at most
+constexpr int MAX_SPLIT_PLY = 3;
+
+// A subtree identified by the moves leading to it from the root
+struct Task
+{
+    Move path[MAX_SPLIT_PLY];
+    int length;
+    int rootIndex;
+};
+
+// A deque of tasks owned by one worker. The owner pops from the back while idle workers
+// steal from the front, so they take the tasks the owner would have reached last.
+class TaskQueue {
+public:
+    void Push(const Task& task);
+    bool Pop(Task& task);
+    bool Steal(Task& task);
+
+private:
+    std::mutex mutex;
+    std::deque<Task> tasks;
+};
+
 uint64_t perft(Position& pos, int depth, bool isRoot = false);
-std::string getString(Move move);
+uint64_t parallelPerft(const Position& pos, int depth, int numThreads, const MoveList& rootMoves, uint64_t rootCounts[]);
+void collectTasks(Position& pos, int ply, int splitPly, Task& task, std::vector<Task>& tasks);
 
 } // anonymous namespace
 
-void go(Position& pos, int depth)
+void go(Position& pos, int depth, int numThreads /*= 1*/)
 {
-    assert(depth >= 0);
+    assert(depth >= 0 && numThreads >= 1);
 
     std::cout << "Running performance test\n\n";
 
     auto start = std::chrono::high_resolution_clock::now();
 
-    uint64_t nodes = perft(pos, depth, true);
+    uint64_t nodes;
+
+    if (numThreads == 1)
+        nodes = perft(pos, depth, true);
+
+    else
+    {
+        MoveList rootMoves;
+        uint64_t rootCounts[MAX_MOVES];
+
+        MoveGen::generate(pos, rootMoves);
+        nodes = parallelPerft(pos, depth, numThreads, rootMoves, rootCounts);
+
+        for (int i = 0; i < rootMoves.count && depth > 0; i++)
+            std::cout << "    " << UCI::moveToString(rootMoves.moves[i].move) << ": " << rootCounts[i] << "\n";
+    }
 
     auto stop = std::chrono::high_resolution_clock::now();
     auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(stop - start);
@@ -33,22 +125,113 @@ void go(Position& pos, int depth)
     std::cout << "Time: "    << duration.count() << " milliseconds\n" << std::endl;
 }
 
-uint64_t getNodes(Position& pos, int depth)
+uint64_t getNodes(Position& pos, int depth, int numThreads /*= 1*/)
+{
+    assert(numThreads >= 1);
+
+    if (numThreads == 1)
+        return perft(pos, depth);
+
+    MoveList rootMoves;
+    uint64_t rootCounts[MAX_MOVES];
+
+    MoveGen::generate(pos, rootMoves);
+    return parallelPerft(pos, depth, numThreads, rootMoves, rootCounts);
+}
+
+void setCacheSize(size_t megabytes)
 {
-    return perft(pos, depth);
+    cache.Resize(megabytes);
+}
+
+CacheStats cacheStats()
+{
+    return cache.Stats();
 }
 
 namespace {  // anonymous namespace
 
+void Cache::Resize(size_t megabytes)
+{
+    numBuckets = megabytes * 1024 * 1024 / sizeof(Bucket);
+    table.reset(numBuckets ? new Bucket[numBuckets] : nullptr);
+    Clear();
+}
+
+void Cache::Clear()
+{
+    for (size_t i = 0; i < numBuckets; i++)
+    {
+        for (Entry& entry : table[i].entries)
+        {
+            entry.keyXorData.store(0, std::memory_order_relaxed);
+            entry.data.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    probes = 0;
+    hits = 0;
+}
+
+bool Cache::Probe(Key key, int depth, uint64_t& nodes)
+{
+    probes.fetch_add(1, std::memory_order_relaxed);
+
+    for (Entry& entry : GetBucket(key, depth).entries)
+    {
+        uint64_t data = entry.data.load(std::memory_order_relaxed);
+
+        if ((entry.keyXorData.load(std::memory_order_relaxed) ^ data) == key && int(data >> DEPTH_SHIFT) == depth)
+        {
+            hits.fetch_add(1, std::memory_order_relaxed);
+            nodes = data & NODES_MASK;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void Cache::Store(Key key, int depth, uint64_t nodes)
+{
+    assert(nodes <= NODES_MASK);
+
+    Entry* replace = nullptr;
+    int replaceDepth = 256;
+
+    // Replace the entry with the smallest subtree as it is the cheapest to recompute
+    for (Entry& entry : GetBucket(key, depth).entries)
+    {
+        int entryDepth = int(entry.data.load(std::memory_order_relaxed) >> DEPTH_SHIFT);
+
+        if (entryDepth < replaceDepth)
+        {
+            replace = &entry;
+            replaceDepth = entryDepth;
+        }
+    }
+
+    uint64_t data = (uint64_t(depth) << DEPTH_SHIFT) | nodes;
+
+    replace->keyXorData.store(key ^ data, std::memory_order_relaxed);
+    replace->data.store(data, std::memory_order_relaxed);
+}
+
 uint64_t perft(Position& pos, int depth, bool isRoot /*= false*/)
 {
     // Special case when 0 depth
     if (depth == 0)
         return 1;
 
+    // Depth 1 subtrees are cheaper to count than to look up
+    bool useCache = cache.Enabled() && depth >= 2 && !isRoot;
+    uint64_t nodes = 0;
+
+    if (useCache && cache.Probe(pos.PositionKey(), depth, nodes))
+        return nodes;
+
     MoveList moveList;
     PosInfo posInfo;
-    uint64_t nodes = 0;
 
     // The recursive escape condition
     bool isLeaf = (depth == 2);
@@ -63,11 +246,7 @@ uint64_t perft(Position& pos, int depth, bool isRoot /*= false*/)
         pos.MakeMove(move, posInfo);
 
         if (isLeaf)
-        {
-            MoveList moveListLeaf;
-            MoveGen::generate(pos, moveListLeaf);
-            count = moveListLeaf.count;
-        }
+            count = MoveGen::count(pos);
 
         else 
             count = perft(pos, depth - 1);
@@ -76,23 +255,147 @@ uint64_t perft(Position& pos, int depth, bool isRoot /*= false*/)
         nodes += count;
 
         if (isRoot)
-            std::cout << "    " << getString(move) << ": " << count << "\n";
+            std::cout << "    " << UCI::moveToString(move) << ": " << count << "\n";
+    }
+
+    if (useCache)
+        cache.Store(pos.PositionKey(), depth, nodes);
+
+    return nodes;
+}
+
+// Splits the tree a few plies below the root into subtrees that a pool of workers count in parallel.
+// Every worker owns a copy of the position and its own PosInfo stack, and the per root move counts
+// are kept so that the divide output is the same as for the single threaded perft.
+uint64_t parallelPerft(const Position& pos, int depth, int numThreads, const MoveList& rootMoves, uint64_t rootCounts[])
+{
+    if (depth == 0)
+        return 1;
+
+    Position rootPos;
+    PosInfo rootPosInfo;
+    rootPos.Set(pos, &rootPosInfo);
+
+    // Leave at least two plies below the split so that the leaves keep their bulk counting
+    int splitPly = std::max(1, std::min(MAX_SPLIT_PLY, depth - 2));
+
+    std::vector<Task> tasks;
+    Task task;
+    collectTasks(rootPos, 0, splitPly, task, tasks);
+
+    // Deal the tasks out round robin so every worker starts with a similar share
+    std::vector<std::unique_ptr<TaskQueue>> queues;
+
+    for (int i = 0; i < numThreads; i++)
+        queues.emplace_back(new TaskQueue());
+
+    for (size_t i = 0; i < tasks.size(); i++)
+        queues[i % numThreads]->Push(tasks[i]);
+
+    std::vector<std::atomic<uint64_t>> counts(rootMoves.count);
+    std::vector<std::thread> workers;
+
+    for (int id = 0; id < numThreads; id++)
+    {
+        workers.emplace_back([&, id]() {
+            Position workerPos;
+            PosInfo posInfos[MAX_SPLIT_PLY + 1];
+            Task task;
+
+            while (true)
+            {
+                bool found = queues[id]->Pop(task);
+
+                for (int i = 1; i < numThreads && !found; i++)
+                    found = queues[(id + i) % numThreads]->Steal(task);
+
+                // No tasks are added after the start, so all queues being empty means we are done
+                if (!found)
+                    break;
+
+                workerPos.Set(rootPos, &posInfos[0]);
+
+                for (int ply = 0; ply < task.length; ply++)
+                    workerPos.MakeMove(task.path[ply], posInfos[ply + 1]);
+
+                counts[task.rootIndex].fetch_add(perft(workerPos, depth - task.length), std::memory_order_relaxed);
+            }
+        });
+    }
+
+    for (std::thread& worker : workers)
+        worker.join();
+
+    uint64_t nodes = 0;
+
+    for (int i = 0; i < rootMoves.count; i++)
+    {
+        rootCounts[i] = counts[i].load();
+        nodes += rootCounts[i];
     }
 
     return nodes;
 }
 
-std::string getString(Move move)
+void collectTasks(Position& pos, int ply, int splitPly, Task& task, std::vector<Task>& tasks)
+{
+    assert(splitPly <= MAX_SPLIT_PLY);
+
+    if (ply >= std::min(splitPly, MAX_SPLIT_PLY))
+    {
+        task.length = ply;
+        tasks.push_back(task);
+        return;
+    }
+
+    MoveList moveList;
+    PosInfo posInfo;
+
+    MoveGen::generate(pos, moveList);
+
+    for (int i = 0; i < moveList.count; i++)
+    {
+        Move move = moveList.moves[i].move;
+
+        if (ply == 0)
+            task.rootIndex = i;
+
+        task.path[ply] = move;
+
+        pos.MakeMove(move, posInfo);
+        collectTasks(pos, ply + 1, splitPly, task, tasks);
+        pos.UndoMove(move);
+    }
+}
+
+void TaskQueue::Push(const Task& task)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    tasks.push_back(task);
+}
+
+bool TaskQueue::Pop(Task& task)
 {
-    Square from = getFromSquare(move);
-    Square to   = getToSquare(move);
+    std::lock_guard<std::mutex> lock(mutex);
 
-    std::string moveStr = algebraicNotation(from) + algebraicNotation(to);
+    if (tasks.empty())
+        return false;
+
+    task = tasks.back();
+    tasks.pop_back();
+    return true;
+}
+
+bool TaskQueue::Steal(Task& task)
+{
+    std::lock_guard<std::mutex> lock(mutex);
 
-    if (getMoveType(move) == PROMOTION)
-        moveStr += " pnbrqk"[getPromotionType(move)];
+    if (tasks.empty())
+        return false;
 
-    return moveStr;
+    task = tasks.front();
+    tasks.pop_front();
+    return true;
 }
 
 } // anonymous namespace
@@ -8,8 +8,20 @@ namespace ChessEngine {
 
 namespace Perft {
 
-void go(Position& pos, int depth);
-uint64_t getNodes(Position& pos, int depth);
+struct CacheStats
+{
+    uint64_t probes;
+    uint64_t hits;
+};
+
+// Both run on a pool of worker threads when given more than one thread
+void go(Position& pos, int depth, int numThreads = 1);
+uint64_t getNodes(Position& pos, int depth, int numThreads = 1);
+
+// Sets the memory budget in megabytes of the cache of subtree node counts and empties it,
+// a size of 0 disables the cache
+void setCacheSize(size_t megabytes);
+CacheStats cacheStats();
 
 } // namespace Perft
 
@@ -1,10 +1,13 @@
 #include <iostream>
+#include <algorithm>
 #include <cstring>
+#include <cstddef>
 #include <sstream>
 #include <string_view>
 #include <map>
 
 #include "position.h"
+#include "psqt.h"
 
 namespace ChessEngine {
 
@@ -12,11 +15,66 @@ namespace {  // anonymous namespace
 
 constexpr std::string_view PieceToAscii(" PNBRQK  pnbrqk");
 
+// Random keys used to hash a position, see: https://www.chessprogramming.org/Zobrist_Hashing
+namespace Zobrist {
+
+Key pieceSquare[NUM_PIECES][NUM_SQUARES];
+Key enpassant[NUM_FILES];
+Key castling[ANY_CASTLING + 1];
+Key side;
+Key noPawns;
+
+// The key of the n-th piece of a kind, so that the material key only depends on the piece counts
+Key material[NUM_PIECES][MAX_PIECE_COUNT];
+
+} // namespace Zobrist
+
+inline Key random64()
+{
+    static Key random = 1070372ULL;
+
+    // XOR shift star algorithm
+    random ^= random >> 12;
+    random ^= random << 25;
+    random ^= random >> 27;
+
+    return random * 2685821657736338717ULL;
+}
+
 } // anonymous namespace
 
 void Position::Init()
 {
+    for (Piece piece : {WHITE_PAWN, WHITE_KNIGHT, WHITE_BISHOP, WHITE_ROOK, WHITE_QUEEN, WHITE_KING,
+                        BLACK_PAWN, BLACK_KNIGHT, BLACK_BISHOP, BLACK_ROOK, BLACK_QUEEN, BLACK_KING})
+        for (Square sq = A1; sq < NUM_SQUARES; sq++)
+            Zobrist::pieceSquare[piece][sq] = random64();
+
+    for (File file = FILE_A; file < NUM_FILES; file++)
+        Zobrist::enpassant[file] = random64();
 
+    // Each combination of castling rights gets the XOR of the keys of its single rights
+    // so that adding or removing one right is a single XOR
+    Key singleRights[4] = { random64(), random64(), random64(), random64() };
+
+    for (int cr = NO_CASTLING; cr <= ANY_CASTLING; cr++)
+    {
+        Zobrist::castling[cr] = 0;
+
+        for (int i = 0; i < 4; i++)
+            if (cr & (1 << i))
+                Zobrist::castling[cr] ^= singleRights[i];
+    }
+
+    Zobrist::side = random64();
+
+    // Keeps the pawn key of a position without pawns apart from an empty pawn table entry
+    Zobrist::noPawns = random64();
+
+    for (Piece piece : {WHITE_PAWN, WHITE_KNIGHT, WHITE_BISHOP, WHITE_ROOK, WHITE_QUEEN, WHITE_KING,
+                        BLACK_PAWN, BLACK_KNIGHT, BLACK_BISHOP, BLACK_ROOK, BLACK_QUEEN, BLACK_KING})
+        for (int count = 0; count < MAX_PIECE_COUNT; count++)
+            Zobrist::material[piece][count] = random64();
 }
 
 
@@ -70,6 +128,41 @@ Position& Position::Set(const std::string& fen, PosInfo* posInfo)
     ParseEnpassantSquare(ss); // 4. En passant target square
     ParseMoveCounters(ss);    // 5-6. Halfmove clock and Fullmove number
 
+    posInfo->key         = ComputeKey();
+    posInfo->pawnKey     = ComputePawnKey();
+    posInfo->materialKey = ComputeMaterialKey();
+    SetCheckingData();
+
+    return *this;
+}
+
+Position& Position::Set(const Position& pos, PosInfo* posInfo)
+{
+    *this = pos;
+    *posInfo = *pos.posInfo;
+    this->posInfo = posInfo;
+
+    // Without dirty pieces the accumulators are never updated from the shared plies
+    posInfo->dirtyPiece.count = 0;
+
+    return *this;
+}
+
+Position& Position::Set(const Piece pieces[], const Square squares[], int count, Color side, PosInfo* posInfo)
+{
+    *this = Position();
+    *posInfo = PosInfo();
+    this->posInfo = posInfo;
+
+    for (int i = 0; i < count; i++)
+        PlacePiece(pieces[i], squares[i]);
+
+    sideToMove = side;
+    posInfo->enpassantSquare = NO_SQUARE;
+
+    posInfo->key         = ComputeKey();
+    posInfo->pawnKey     = ComputePawnKey();
+    posInfo->materialKey = ComputeMaterialKey();
     SetCheckingData();
 
     return *this;
@@ -147,11 +240,13 @@ void Position::ParseMoveCounters(std::istringstream& ss)
 {
     ss >> std::skipws >> posInfo->fiftyMoveCounter;
 
-    int fullmove;
+    // The counters are optional
+    int fullmove = 1;
     ss >> fullmove;
-    ply = 2 * (fullmove - 1) + (sideToMove == BLACK);
+    ply = 2 * (std::max(fullmove, 1) - 1) + (sideToMove == BLACK);
 }
 
+// Sets the check info of the side to move, which every move generation needs
 void Position::SetCheckingData()
 {
     Color us = sideToMove;
@@ -159,13 +254,24 @@ void Position::SetCheckingData()
 
     posInfo->checkersBoard = AttackersTo(KingSquare(us)) & Pieces(them);
 
-    Bitboard ourKingBlockers   = SliderBlockers(us,   KingSquare(us),   posInfo->pinners[them]);
+    Bitboard ourKingBlockers = SliderBlockers(us, KingSquare(us), posInfo->pinners[them]);
+
+    posInfo->pinned[us]      = ourKingBlockers & Pieces(us);
+    posInfo->discovery[them] = ourKingBlockers & Pieces(them);
+    posInfo->checkInfoReady  = false;
+}
+
+// Sets the info about the king of the side not to move, only
+// needed when looking for moves that give check
+void Position::SetCheckInfo() const
+{
+    Color us = sideToMove;
+    Color them = ~us;
+
     Bitboard theirKingBlockers = SliderBlockers(them, KingSquare(them), posInfo->pinners[us]);
 
-    posInfo->pinned[us]      = ourKingBlockers   & Pieces(us);
-    posInfo->pinned[them]    = theirKingBlockers & Pieces(them);
-    posInfo->discovery[us]   = theirKingBlockers & Pieces(us);
-    posInfo->discovery[them] = ourKingBlockers   & Pieces(them);
+    posInfo->pinned[them]  = theirKingBlockers & Pieces(them);
+    posInfo->discovery[us] = theirKingBlockers & Pieces(us);
 
     Square target = KingSquare(them);
 
@@ -174,6 +280,7 @@ void Position::SetCheckingData()
     posInfo->checkSquares[BISHOP] = attackMask(BISHOP, target, Pieces());
     posInfo->checkSquares[ROOK]   = attackMask(ROOK,   target, Pieces());
     posInfo->checkSquares[QUEEN]  = posInfo->checkSquares[BISHOP] | posInfo->checkSquares[ROOK];
+    posInfo->checkInfoReady       = true;
 }
 
 Bitboard Position::SliderBlockers(Color blocker, Square target, Bitboard& pinners) const
@@ -270,6 +377,77 @@ Bitboard Position::AttackersTo(Square square, Bitboard occupancy) const
          | (attackMask(KING, square)              & Pieces(KING));
 }
 
+Key Position::ComputeKey() const
+{
+    Key key = Zobrist::castling[posInfo->castlingRights];
+
+    for (Square sq = A1; sq < NUM_SQUARES; sq++)
+        if (PieceOn(sq) != EMPTY)
+            key ^= Zobrist::pieceSquare[PieceOn(sq)][sq];
+
+    if (posInfo->enpassantSquare != NO_SQUARE)
+        key ^= Zobrist::enpassant[getFile(posInfo->enpassantSquare)];
+
+    if (sideToMove == BLACK)
+        key ^= Zobrist::side;
+
+    return key;
+}
+
+Key Position::ComputePawnKey() const
+{
+    Key key = Zobrist::noPawns;
+    Bitboard pawns = Pieces(PAWN);
+
+    while (pawns)
+    {
+        Square sq = popSquare(pawns);
+        key ^= Zobrist::pieceSquare[PieceOn(sq)][sq];
+    }
+
+    return key;
+}
+
+Key Position::ComputeMaterialKey() const
+{
+    Key key = 0;
+
+    for (Piece piece : {WHITE_PAWN, WHITE_KNIGHT, WHITE_BISHOP, WHITE_ROOK, WHITE_QUEEN, WHITE_KING,
+                        BLACK_PAWN, BLACK_KNIGHT, BLACK_BISHOP, BLACK_ROOK, BLACK_QUEEN, BLACK_KING})
+        for (int count = 0; count < numPieces[piece]; count++)
+            key ^= Zobrist::material[piece][count];
+
+    return key;
+}
+
+Score Position::ComputePsq() const
+{
+    Score psq = {0, 0};
+
+    for (Square sq = A1; sq < NUM_SQUARES; sq++)
+        if (PieceOn(sq) != EMPTY)
+            psq += PSQT::table[PieceOn(sq)][sq];
+
+    return psq;
+}
+
+Key Position::KeyAfter(Move move) const
+{
+    Square from    = getFromSquare(move);
+    Square to      = getToSquare(move);
+    Piece piece    = PieceOn(from);
+    Piece captured = PieceOn(to);
+
+    Key key = posInfo->key ^ Zobrist::side
+            ^ Zobrist::pieceSquare[piece][from]
+            ^ Zobrist::pieceSquare[piece][to];
+
+    if (captured != EMPTY)
+        key ^= Zobrist::pieceSquare[captured][to];
+
+    return key;
+}
+
 bool Position::SquaresNotAttacked(Bitboard bitboard, Color attacker) const
 {
     while (bitboard)
@@ -281,9 +459,148 @@ bool Position::SquaresNotAttacked(Bitboard bitboard, Color attacker) const
     return true;
 }
 
+// The pieces of the side that can take part in the exchange. A pinned piece
+// cannot leave the line to its king while the pinner is still on the board
+Bitboard Position::ExchangeAttackers(Color side, Bitboard attackers, Bitboard occupancy) const
+{
+    Bitboard sideAttackers = attackers & Pieces(side);
+
+    if (Pinners(~side) & occupancy)
+        sideAttackers &= ~Pinned(side);
+
+    return sideAttackers;
+}
+
+// Takes the least valuable of the given attackers off the board. The sliders behind it on
+// the same line now see the square, so they are added to the attackers from the new occupancy.
+PieceType Position::PopLeastValuable(Square square, Bitboard sideAttackers, Bitboard& attackers, Bitboard& occupancy) const
+{
+    PieceType pt = PAWN;
+
+    while (!(sideAttackers & Pieces(pt)))
+        pt++;
+
+    occupancy ^= firstSquare(sideAttackers & Pieces(pt));
+
+    if (pt == PAWN || pt == BISHOP || pt == QUEEN)
+        attackers |= attackMask(BISHOP, square, occupancy) & Pieces(BISHOP, QUEEN);
+
+    if (pt == ROOK || pt == QUEEN)
+        attackers |= attackMask(ROOK, square, occupancy) & Pieces(ROOK, QUEEN);
+
+    attackers &= occupancy;
+
+    return pt;
+}
+
+// Plays out the captures on the target square with the least valuable attacker first, both sides
+// can stop capturing when it would lose material. The gains are collected in a swap list and
+// then minimaxed back from the end. See: https://www.chessprogramming.org/SEE_-_The_Swap_Algorithm
+// Promotions, en passant and castling are evaluated as 0.
+int Position::SEE(Move move) const
+{
+    if (getMoveType(move) != NORMAL)
+        return 0;
+
+    Square from = getFromSquare(move);
+    Square to   = getToSquare(move);
+
+    int gain[32];
+    int depth = 0;
+    Color side = sideToMove;
+    Bitboard occupancy = Pieces() ^ from ^ to;
+    Bitboard attackers = AttackersTo(to, occupancy) & occupancy;
+    PieceType onSquare = getType(PieceOn(from));
+
+    gain[0] = PieceValue[getType(PieceOn(to))];
+
+    while (true)
+    {
+        side = ~side;
+
+        Bitboard sideAttackers = ExchangeAttackers(side, attackers, occupancy);
+
+        if (!sideAttackers)
+            break;
+
+        // The king can only capture when the square is not defended anymore
+        if (!(sideAttackers & ~Pieces(KING)) && (attackers & Pieces(~side)))
+            break;
+
+        depth++;
+        gain[depth] = PieceValue[onSquare] - gain[depth - 1];
+
+        // Neither side can improve by continuing the exchange
+        if (std::max(-gain[depth - 1], gain[depth]) < 0)
+            break;
+
+        onSquare = PopLeastValuable(to, sideAttackers, attackers, occupancy);
+    }
+
+    for (; depth > 0; depth--)
+        gain[depth - 1] = -std::max(-gain[depth - 1], gain[depth]);
+
+    return gain[0];
+}
+
+// Same exchange as SEE, but only decides whether the result reaches the threshold. The balance is
+// kept relative to the threshold, so the exchange can stop as soon as one side cannot fall below it.
+bool Position::SEE_GE(Move move, int threshold /*= 0*/) const
+{
+    if (getMoveType(move) != NORMAL)
+        return 0 >= threshold;
+
+    Square from = getFromSquare(move);
+    Square to   = getToSquare(move);
+
+    // Even winning the captured piece for free does not reach the threshold
+    int balance = PieceValue[getType(PieceOn(to))] - threshold;
+
+    if (balance < 0)
+        return false;
+
+    // Even losing the capturing piece for nothing stays above the threshold
+    balance = PieceValue[getType(PieceOn(from))] - balance;
+
+    if (balance <= 0)
+        return true;
+
+    Color side = sideToMove;
+    Bitboard occupancy = Pieces() ^ from ^ to;
+    Bitboard attackers = AttackersTo(to, occupancy) & occupancy;
+    bool result = true;
+
+    while (true)
+    {
+        side = ~side;
+
+        Bitboard sideAttackers = ExchangeAttackers(side, attackers, occupancy);
+
+        if (!sideAttackers)
+            break;
+
+        // The king can only capture when the square is not defended anymore
+        if (!(sideAttackers & ~Pieces(KING)))
+            return (attackers & Pieces(~side)) ? result : !result;
+
+        result = !result;
+
+        PieceType pt = PopLeastValuable(to, sideAttackers, attackers, occupancy);
+
+        // The side now to capture would stay on the right side of the threshold even if it loses the piece
+        balance = PieceValue[pt] - balance;
+
+        if (balance < int(result))
+            break;
+    }
+
+    return result;
+}
+
 void Position::MakeMove(Move move, PosInfo& newPosInfo)
 {
-    std::memcpy(&newPosInfo, posInfo, sizeof(PosInfo));
+    // Only the irreversible state is carried over, the rest is recomputed below
+    std::memcpy(&newPosInfo, posInfo, offsetof(PosInfo, prev));
     newPosInfo.prev = posInfo;
     posInfo = &newPosInfo;
 
@@ -303,6 +620,10 @@ void Position::MakeMove(Move move, PosInfo& newPosInfo)
     posInfo->fiftyMoveCounter++;
     posInfo->movesFromNull++;
 
+    posInfo->dirtyPiece.count = 0;
+    posInfo->accumulator.computed[WHITE] = false;
+    posInfo->accumulator.computed[BLACK] = false;
+
     if (moveType == CASTLING)
     {
         MakeCastling(move);
@@ -319,39 +640,76 @@ void Position::MakeMove(Move move, PosInfo& newPosInfo)
             capturedSq -= pawnDir;
         
         RemovePiece(capturedSq);
+        posInfo->dirtyPiece.add(capturedPiece, capturedSq, NO_SQUARE);
+
+        if (getType(capturedPiece) == PAWN)
+            posInfo->pawnKey ^= Zobrist::pieceSquare[capturedPiece][capturedSq];
+
+        posInfo->materialKey ^= Zobrist::material[capturedPiece][numPieces[capturedPiece]];
+
         posInfo->fiftyMoveCounter = 0;
     }
 
     // Update castling rights if it has changed
     if (posInfo->castlingRights &&  (castlingRightsMask[from] | castlingRightsMask[to]))
+    {
+        posInfo->key ^= Zobrist::castling[posInfo->castlingRights];
         posInfo->castlingRights &= ~(castlingRightsMask[from] | castlingRightsMask[to]);
+        posInfo->key ^= Zobrist::castling[posInfo->castlingRights];
+    }
 
     // Move the piece
     if (moveType != CASTLING)
+    {
         MovePiece(from, to);
+        posInfo->dirtyPiece.add(movedPiece, from, to);
+    }
     
     // Reset the en passant square
-    posInfo->enpassantSquare = NO_SQUARE;
+    if (posInfo->enpassantSquare != NO_SQUARE)
+    {
+        posInfo->key ^= Zobrist::enpassant[getFile(posInfo->enpassantSquare)];
+        posInfo->enpassantSquare = NO_SQUARE;
+    }
 
     if (pt == PAWN)
     {
+        posInfo->pawnKey ^= Zobrist::pieceSquare[movedPiece][from] ^ Zobrist::pieceSquare[movedPiece][to];
+
         // Set en passant square if double pawn push that is attacked on the square behind the pawn
         if ((int(to) ^ int(from)) == 16 && (pawnAttackMask(us, to - pawnDir) & Pieces(PAWN, them)))
+        {
             posInfo->enpassantSquare = to - pawnDir;
+            posInfo->key ^= Zobrist::enpassant[getFile(to)];
+        }
 
         if (moveType == PROMOTION)
         {
             Piece promomotionPiece = getPiece(getPromotionType(move), us);
             RemovePiece(to);
             PlacePiece(promomotionPiece, to);
+            posInfo->dirtyPiece.add(movedPiece, to, NO_SQUARE);
+            posInfo->dirtyPiece.add(promomotionPiece, NO_SQUARE, to);
+            posInfo->pawnKey ^= Zobrist::pieceSquare[movedPiece][to];
+            posInfo->materialKey ^= Zobrist::material[movedPiece][numPieces[movedPiece]]
+                                  ^ Zobrist::material[promomotionPiece][numPieces[promomotionPiece] - 1];
         }
         
         posInfo->fiftyMoveCounter = 0;
     }
       
     posInfo->capturedPiece = capturedPiece;
+    posInfo->key ^= Zobrist::side;
     sideToMove = ~sideToMove;
 
+    SetRepetition();
+
+    // The incrementally updated keys and score must match a full recompute
+    assert(posInfo->key == ComputeKey());
+    assert(posInfo->pawnKey == ComputePawnKey());
+    assert(posInfo->materialKey == ComputeMaterialKey());
+    assert(posInfo->psq == ComputePsq());
+
     SetCheckingData();
 }
 
@@ -395,6 +753,28 @@ void Position::UndoMove(Move move)
     ply--;
 }
 
+// A position can only repeat with the same side to move and since the last irreversible move,
+// so at most every other ply back to the last capture, pawn move or null move is compared
+void Position::SetRepetition()
+{
+    int end = std::min(posInfo->fiftyMoveCounter, posInfo->movesFromNull);
+    const PosInfo* info = posInfo;
+
+    posInfo->repetition = 0;
+
+    // The history can start later than the counters, e.g. from a FEN
+    for (int i = 2; i <= end && info->prev && info->prev->prev; i += 2)
+    {
+        info = info->prev->prev;
+
+        if (info->key == posInfo->key)
+        {
+            posInfo->repetition = (info->repetition ? -i : i);
+            return;
+        }
+    }
+}
+
 void Position::MakeCastling(Move move)
 {
     Color us = sideToMove;
@@ -409,6 +789,8 @@ void Position::MakeCastling(Move move)
 
     MovePiece(kingFrom, kingTo);
     MovePiece(rookFrom, rookTo);
+    posInfo->dirtyPiece.add(getPiece(KING, us), kingFrom, kingTo);
+    posInfo->dirtyPiece.add(getPiece(ROOK, us), rookFrom, rookTo);
 }
 
 void Position::UndoCastling(Move move)
@@ -438,6 +820,9 @@ void Position::PlacePiece(Piece piece, Square square)
 
     numPieces[piece]++;
     numPieces[getPiece(ALL_PIECES, getColor(piece))]++;
+
+    posInfo->key ^= Zobrist::pieceSquare[piece][square];
+    posInfo->psq += PSQT::table[piece][square];
 }
 
 void Position::MovePiece(Square from, Square to)
@@ -451,6 +836,9 @@ void Position::MovePiece(Square from, Square to)
     typeBoard[ALL_PIECES]       ^= moveMask;
     typeBoard[getType(piece)]   ^= moveMask;
     colorBoard[getColor(piece)] ^= moveMask;
+
+    posInfo->key ^= Zobrist::pieceSquare[piece][from] ^ Zobrist::pieceSquare[piece][to];
+    posInfo->psq += PSQT::table[piece][to] - PSQT::table[piece][from];
 }
 
 void Position::RemovePiece(Square square)
@@ -466,6 +854,9 @@ void Position::RemovePiece(Square square)
 
     numPieces[piece]--;
     numPieces[getPiece(ALL_PIECES, getColor(piece))]--;
+
+    posInfo->key ^= Zobrist::pieceSquare[piece][square];
+    posInfo->psq -= PSQT::table[piece][square];
 }
 
 void Position::SetCastlingRights(CastlingRight cr)
@@ -5,23 +5,45 @@
 #include <cassert>
 
 #include "bitboard.h"
+#include "nnue.h"
 
 namespace ChessEngine {
 
+// The state of a position that is not kept on the board, one per ply. MakeMove only copies the
+// irreversible fields up to prev, everything after it is recomputed for the new position.
 struct PosInfo {
+    // Copied by MakeMove
+    Key key;
+    Key pawnKey;
+    Key materialKey;
+    Score psq;
     Square enpassantSquare;
     uint8_t castlingRights;
     int fiftyMoveCounter;
     int movesFromNull;
     
+    // Set by MakeMove
     PosInfo* prev;
     Bitboard checkersBoard;
+    Piece capturedPiece;
+
+    // The distance in plies to the previous occurrence of the position,
+    // negative if that was a repetition itself and 0 if there is none
+    int repetition;
+
+    // Every move generation needs the pins on the king of the side to move, so they are set
+    // eagerly. The pins on the other king, our discovered checks and the check squares are
+    // only needed to find checking moves and are computed the first time they are asked for.
+    bool checkInfoReady;
     Bitboard pinners[NUM_COLORS];
     Bitboard pinned[NUM_COLORS];
     Bitboard discovery[NUM_COLORS];
     Bitboard checkSquares[NUM_PIECE_TYPES];
-    Piece capturedPiece;
-    int repetition;
+
+    // The pieces changed by the move to this ply and the NNUE accumulators, which are
+    // only computed when the position is evaluated
+    NNUE::DirtyPiece dirtyPiece;
+    NNUE::Accumulator accumulator;
 };
 
 class Position {
@@ -33,8 +55,16 @@ public:
 
     // Get/set FEN string
     Position& Set(const std::string& fen, PosInfo* posInfo);
+
+    // Copies the board and the current state of the given position. The copy only reads the
+    // earlier plies of the original to detect repetitions, so it can be searched independently
+    Position& Set(const Position& pos, PosInfo* posInfo);
     std::string FEN() const;
 
+    // Places the pieces on their squares without castling or en passant rights. Faster than going
+    // through a FEN, for the tablebase generator which sets up every position of an ending
+    Position& Set(const Piece pieces[], const Square squares[], int count, Color side, PosInfo* posInfo);
+
     // Position pieces 
     Square KingSquare(Color color) const;
     inline Bitboard Pieces(PieceType pt, Color color)   const { return Pieces(pt) & Pieces(color); }
@@ -45,12 +75,12 @@ public:
     inline int NumPieces(PieceType pt, Color color)     const { return numPieces[getPiece(pt, color)]; }
     inline int NumPieces(PieceType pt)                  const { return NumPieces(pt, WHITE) + NumPieces(pt, BLACK); }
 
-    // Checking
+    // Checking. The info about the king of the side not to move is computed on first use
     inline Bitboard Checkers() const { return posInfo->checkersBoard; }
-    inline Bitboard CheckSquares(PieceType pt) const { return posInfo->checkSquares[pt]; }
-    inline Bitboard Pinned(Color color) const { return posInfo->pinned[color]; }
-    inline Bitboard Discovery(Color color) const { return posInfo->discovery[color]; }
-    inline Bitboard Pinners(Color color) const { return posInfo->pinners[color]; }
+    inline Bitboard CheckSquares(PieceType pt) const { return CheckInfo().checkSquares[pt]; }
+    inline Bitboard Pinned(Color color) const { return (color == sideToMove ? *posInfo : CheckInfo()).pinned[color]; }
+    inline Bitboard Discovery(Color color) const { return (color != sideToMove ? *posInfo : CheckInfo()).discovery[color]; }
+    inline Bitboard Pinners(Color color) const { return (color != sideToMove ? *posInfo : CheckInfo()).pinners[color]; }
 
     // Attack info
     Bitboard AttackersTo(Square square, Bitboard occupancy) const;
@@ -59,11 +89,51 @@ public:
     inline bool SquareIsAttacked(Square square, Color attacker) const { return AttackersTo(square) & Pieces(attacker); }
     bool SquaresNotAttacked(Bitboard bitboard, Color attacker) const;
 
+    // Move properties, must be called before the move is made
+    inline bool IsCapture(Move move) const
+    {
+        return PieceOn(getToSquare(move)) != EMPTY || getMoveType(move) == EN_PASSANT;
+    }
+
+    // Static exchange evaluation of the captures on the target square of the move,
+    // the material the side to move wins or loses in centipawns
+    int SEE(Move move) const;
+    bool SEE_GE(Move move, int threshold = 0) const;
+
     // Getters of member variables
     inline Color SideToMove() const       { return sideToMove; }
     inline uint8_t CastlingRights() const { return posInfo->castlingRights; }
     inline Piece CapturedPiece() const    { return posInfo->capturedPiece; }
     inline Square EnpassantSquare() const { return posInfo->enpassantSquare; }
+    inline Key PositionKey() const        { return posInfo->key; }
+    inline Key PawnKey() const            { return posInfo->pawnKey; }
+    inline Key MaterialKey() const        { return posInfo->materialKey; }
+    inline int FiftyMoveCounter() const   { return posInfo->fiftyMoveCounter; }
+
+    // A position repeated after the given search ply, or repeated twice, is a draw
+    inline bool IsRepetition(int ply) const { return posInfo->repetition && posInfo->repetition < ply; }
+
+    // The state of the current ply, the NNUE accumulators are updated lazily through it
+    inline PosInfo* Info() const          { return posInfo; }
+
+    // The material and piece-square score from white's point of view, updated with the pieces
+    inline Score PsqScore() const         { return posInfo->psq; }
+
+    // Computes the Zobrist key of the position from scratch
+    Key ComputeKey() const;
+
+    // Computes the Zobrist key of only the pawns from scratch
+    Key ComputePawnKey() const;
+
+    // Computes the key of the piece counts from scratch
+    Key ComputeMaterialKey() const;
+
+    // Computes the material and piece-square score from scratch
+    Score ComputePsq() const;
+
+    // Cheaply approximates the key after the given move, ignoring castling and
+    // en passant changes. Used to prefetch hash entries before making the move
+    Key KeyAfter(Move move) const;
 
     // Making and undoing moves
     void MakeMove(Move move, PosInfo& newPosInfo);
@@ -79,11 +149,16 @@ private:
 
     void SetCastlingRights(CastlingRight cr);
 
+    void SetRepetition();
     void MakeCastling(Move move);
     void UndoCastling(Move move);
 
     Bitboard SliderBlockers(Color attacker, Square target, Bitboard& pinners) const;
 
+    // Helpers for the static exchange evaluation
+    Bitboard ExchangeAttackers(Color side, Bitboard attackers, Bitboard occupancy) const;
+    PieceType PopLeastValuable(Square square, Bitboard sideAttackers, Bitboard& attackers, Bitboard& occupancy) const;
+
     // Helpers for initialization
     void ParsePiecePlacement(std::istringstream& ss);
     void ParseActiveColor(std::istringstream& ss);
@@ -91,6 +166,15 @@ private:
     void ParseEnpassantSquare(std::istringstream& ss);
     void ParseMoveCounters(std::istringstream& ss);
     void SetCheckingData();
+    void SetCheckInfo() const;
+
+    inline const PosInfo& CheckInfo() const
+    {
+        if (!posInfo->checkInfoReady)
+            SetCheckInfo();
+
+        return *posInfo;
+    }
 
     PosInfo* posInfo;
     Piece pieceOnSquare[NUM_SQUARES];
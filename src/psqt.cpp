@@ -0,0 +1,131 @@
+#include "psqt.h"
+
+namespace ChessEngine {
+
+namespace {  // anonymous namespace
+
+// Indexed by PieceType
+constexpr Score Material[NUM_PIECE_TYPES] = {
+    {0, 0}, {82, 94}, {337, 281}, {365, 297}, {477, 512}, {1025, 936}, {0, 0}, {0, 0}
+};
+
+// Piece-square bonuses for white, written as seen from white's side of the board, so the first
+// row is rank 8. The pieces other than the pawns and the king keep the same bonus in the endgame.
+// Based on: https://www.chessprogramming.org/Simplified_Evaluation_Function
+constexpr int PawnMg[NUM_SQUARES] = {
+      0,   0,   0,   0,   0,   0,   0,   0,
+     50,  50,  50,  50,  50,  50,  50,  50,
+     10,  10,  20,  30,  30,  20,  10,  10,
+      5,   5,  10,  25,  25,  10,   5,   5,
+      0,   0,   0,  20,  20,   0,   0,   0,
+      5,  -5, -10,   0,   0, -10,  -5,   5,
+      5,  10,  10, -20, -20,  10,  10,   5,
+      0,   0,   0,   0,   0,   0,   0,   0
+};
+
+constexpr int PawnEg[NUM_SQUARES] = {
+      0,   0,   0,   0,   0,   0,   0,   0,
+     80,  80,  80,  80,  80,  80,  80,  80,
+     50,  50,  50,  50,  50,  50,  50,  50,
+     30,  30,  30,  30,  30,  30,  30,  30,
+     20,  20,  20,  20,  20,  20,  20,  20,
+     10,  10,  10,  10,  10,  10,  10,  10,
+     10,  10,  10,  10,  10,  10,  10,  10,
+      0,   0,   0,   0,   0,   0,   0,   0
+};
+
+constexpr int Knight[NUM_SQUARES] = {
+    -50, -40, -30, -30, -30, -30, -40, -50,
+    -40, -20,   0,   0,   0,   0, -20, -40,
+    -30,   0,  10,  15,  15,  10,   0, -30,
+    -30,   5,  15,  20,  20,  15,   5, -30,
+    -30,   0,  15,  20,  20,  15,   0, -30,
+    -30,   5,  10,  15,  15,  10,   5, -30,
+    -40, -20,   0,   5,   5,   0, -20, -40,
+    -50, -40, -30, -30, -30, -30, -40, -50
+};
+
+constexpr int Bishop[NUM_SQUARES] = {
+    -20, -10, -10, -10, -10, -10, -10, -20,
+    -10,   0,   0,   0,   0,   0,   0, -10,
+    -10,   0,   5,  10,  10,   5,   0, -10,
+    -10,   5,   5,  10,  10,   5,   5, -10,
+    -10,   0,  10,  10,  10,  10,   0, -10,
+    -10,  10,  10,  10,  10,  10,  10, -10,
+    -10,   5,   0,   0,   0,   0,   5, -10,
+    -20, -10, -10, -10, -10, -10, -10, -20
+};
+
+constexpr int Rook[NUM_SQUARES] = {
+      0,   0,   0,   0,   0,   0,   0,   0,
+      5,  10,  10,  10,  10,  10,  10,   5,
+     -5,   0,   0,   0,   0,   0,   0,  -5,
+     -5,   0,   0,   0,   0,   0,   0,  -5,
+     -5,   0,   0,   0,   0,   0,   0,  -5,
+     -5,   0,   0,   0,   0,   0,   0,  -5,
+     -5,   0,   0,   0,   0,   0,   0,  -5,
+      0,   0,   0,   5,   5,   0,   0,   0
+};
+
+constexpr int Queen[NUM_SQUARES] = {
+    -20, -10, -10,  -5,  -5, -10, -10, -20,
+    -10,   0,   0,   0,   0,   0,   0, -10,
+    -10,   0,   5,   5,   5,   5,   0, -10,
+     -5,   0,   5,   5,   5,   5,   0,  -5,
+      0,   0,   5,   5,   5,   5,   0,  -5,
+    -10,   5,   5,   5,   5,   5,   0, -10,
+    -10,   0,   5,   0,   0,   0,   0, -10,
+    -20, -10, -10,  -5,  -5, -10, -10, -20
+};
+
+// The king hides behind its pawns in the midgame and becomes active in the endgame
+constexpr int KingMg[NUM_SQUARES] = {
+    -30, -40, -40, -50, -50, -40, -40, -30,
+    -30, -40, -40, -50, -50, -40, -40, -30,
+    -30, -40, -40, -50, -50, -40, -40, -30,
+    -30, -40, -40, -50, -50, -40, -40, -30,
+    -20, -30, -30, -40, -40, -30, -30, -20,
+    -10, -20, -20, -20, -20, -20, -20, -10,
+     20,  20,   0,   0,   0,   0,  20,  20,
+     20,  30,  10,   0,   0,  10,  30,  20
+};
+
+constexpr int KingEg[NUM_SQUARES] = {
+    -50, -40, -30, -20, -20, -30, -40, -50,
+    -30, -20, -10,   0,   0, -10, -20, -30,
+    -30, -10,  20,  30,  30,  20, -10, -30,
+    -30, -10,  30,  40,  40,  30, -10, -30,
+    -30, -10,  30,  40,  40,  30, -10, -30,
+    -30, -10,  20,  30,  30,  20, -10, -30,
+    -30, -30,   0,   0,   0,   0, -30, -30,
+    -50, -30, -30, -30, -30, -30, -30, -50
+};
+
+constexpr const int* BonusMg[NUM_PIECE_TYPES] = { nullptr, PawnMg, Knight, Bishop, Rook, Queen, KingMg, nullptr };
+constexpr const int* BonusEg[NUM_PIECE_TYPES] = { nullptr, PawnEg, Knight, Bishop, Rook, Queen, KingEg, nullptr };
+
+constexpr std::array<std::array<Score, NUM_SQUARES>, NUM_PIECES> initTable()
+{
+    std::array<std::array<Score, NUM_SQUARES>, NUM_PIECES> table{};
+
+    for (int pt = PAWN; pt <= KING; pt++)
+    {
+        for (int sq = A1; sq < NUM_SQUARES; sq++)
+        {
+            // The bonus tables start from rank 8, which flipped is the view of black
+            Score white = Material[pt] + Score{BonusMg[pt][sq ^ 56], BonusEg[pt][sq ^ 56]};
+            Score black = Material[pt] + Score{BonusMg[pt][sq],      BonusEg[pt][sq]};
+
+            table[getPiece(PieceType(pt), WHITE)][sq] =  white;
+            table[getPiece(PieceType(pt), BLACK)][sq] = -black;
+        }
+    }
+
+    return table;
+}
+
+} // anonymous namespace
+
+constexpr std::array<std::array<Score, NUM_SQUARES>, NUM_PIECES> PSQT::table = initTable();
+
+} // namespace ChessEngine
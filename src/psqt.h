@@ -0,0 +1,20 @@
+#ifndef PSQT_INCLUDED
+#define PSQT_INCLUDED
+
+#include <array>
+
+#include "defs.h"
+
+namespace ChessEngine {
+
+namespace PSQT {
+
+// The material and the piece-square value of every piece on every square, from white's point
+// of view, so a black piece counts negatively. Computed at compile time in psqt.cpp
+extern const std::array<std::array<Score, NUM_SQUARES>, NUM_PIECES> table;
+
+} // namespace PSQT
+
+} // namespace ChessEngine
+
+#endif // PSQT_INCLUDED
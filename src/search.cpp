@@ -1,10 +1,642 @@
-
+#include <iostream>
+#include <sstream>
+#include <chrono>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include <thread>
 
 #include "search.h"
 #include "defs.h"
+#include "position.h"
+#include "movegen.h"
+#include "movepick.h"
+#include "evaluate.h"
+#include "tablebase.h"
+#include "timeman.h"
+#include "tt.h"
+#include "uci.h"
+#include "thread.h"
 
 namespace ChessEngine {
 
+namespace Search {
+
+namespace {  // anonymous namespace
+
+// The clock and the limits are checked once every this many nodes
+constexpr uint64_t CHECK_INTERVAL = 1024;
+
+// The hash entries of the quiescence search are stored below the depth of any main search entry
+constexpr int DEPTH_QS = 0;
+
+// A capture that cannot raise the stand pat score to alpha even with this much of a positional
+// gain on top of the captured material is not searched. See: https://www.chessprogramming.org/Delta_Pruning
+constexpr int DELTA_MARGIN = 200;
+
+// Lazy SMP, the helper threads search the same root and share their results through the
+// transposition table. Helper i skips the iterations where ((depth + SkipPhase[i]) / SkipSize[i])
+// is odd so that the threads spread out over different depths and diverge from each other.
+constexpr int SKIP_TABLE_SIZE = 20;
+constexpr int SkipSize[SKIP_TABLE_SIZE]  = { 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4 };
+constexpr int SkipPhase[SKIP_TABLE_SIZE] = { 0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7 };
+
+Limits limits;
+std::atomic<bool> stopSearch;
+bool reportInfo;
+Info lastInfo;
+
+int aspirationSearch(Thread& thread, Position& pos, int depth, int prevScore);
+int search(Thread& thread, Position& pos, int alpha, int beta, int depth, int ply, bool pvNode);
+int quiescence(Thread& thread, Position& pos, int alpha, int beta, int ply, bool pvNode);
+
+void checkLimits(const Thread& thread);
+void updatePV(Thread& thread, int ply, Move move);
+void updateQuietStats(Thread& thread, const Position& pos, int ply, int depth, Move move, const Move quietsSearched[], int quietCount);
+void printIteration(const Thread& thread, int depth, int score);
+std::string scoreToString(int score);
+int64_t elapsed();
+
+inline int valueToTT(int value, int ply);
+inline int valueFromTT(int value, int ply);
+
+} // anonymous namespace
+
+void start(const Position& pos, const Limits& searchLimits, bool printInfo /*= true*/)
+{
+    Threads.WaitForSearchFinished();
+
+    limits     = searchLimits;
+    reportInfo = printInfo;
+    stopSearch.store(false);
+
+    Time.Init(limits, pos.SideToMove());
+
+    TT.NewSearch();
+    Threads.StartThinking(pos);
+}
+
+Move go(const Position& pos, const Limits& searchLimits, bool printInfo /*= true*/)
+{
+    start(pos, searchLimits, printInfo);
+    Threads.WaitForSearchFinished();
+
+    return lastInfo.bestMove;
+}
+
+void stop()
+{
+    stopSearch.store(true);
+}
+
+const Info& info()
+{
+    return lastInfo;
+}
+
+} // namespace Search
+
+void Thread::IterativeDeepening()
+{
+    using namespace Search;
+
+    bool mainThread = (id == 0);
+
+    if (mainThread)
+        for (size_t i = 1; i < Threads.Size(); i++)
+            Threads.threads[i]->StartSearching();
+
+    int maxDepth = (limits.depth ? std::min(limits.depth, MAX_PLY - 1) : MAX_PLY - 1);
+    int score    = VALUE_ZERO;
+
+    // How settled the search is, for the time manager
+    int stableIterations = 0;
+    int prevScore        = VALUE_ZERO;
+    Move prevBestMove    = MOVE_NONE;
+
+    for (int depth = 1; depth <= maxDepth; depth++)
+    {
+        if (!mainThread)
+        {
+            int i = (id - 1) % SKIP_TABLE_SIZE;
+
+            if (((depth + SkipPhase[i]) / SkipSize[i]) % 2)
+                continue;
+        }
+
+        seldepth = 0;
+
+        int iterationScore = aspirationSearch(*this, rootPos, depth, score);
+
+        // The result of an interrupted iteration is not reliable
+        if (stopSearch.load(std::memory_order_relaxed))
+            break;
+
+        score          = iterationScore;
+        bestScore      = score;
+        bestMove       = (pvLength[0] > 0 ? pv[0][0] : MOVE_NONE);
+        completedDepth = depth;
+
+        if (mainThread && reportInfo)
+            printIteration(*this, depth, score);
+
+        // No legal moves at the root
+        if (bestMove == MOVE_NONE)
+            break;
+
+        if (mainThread && Time.Managed())
+        {
+            stableIterations = (bestMove == prevBestMove ? stableIterations + 1 : 0);
+            prevBestMove     = bestMove;
+
+            // Mate scores say nothing about how the position develops
+            int scoreDrop = (std::abs(prevScore) < VALUE_MATE_IN_MAX_PLY && std::abs(score) < VALUE_MATE_IN_MAX_PLY
+                             && depth > 1 ? prevScore - score : 0);
+
+            prevScore = score;
+
+            if (Time.SoftLimitReached(stableIterations, scoreDrop))
+                break;
+        }
+    }
+
+    if (!mainThread)
+        return;
+
+    // The helpers keep searching until the GUI stops an infinite search
+    while (limits.infinite && !stopSearch.load(std::memory_order_relaxed))
+        std::this_thread::yield();
+
+    // Stop the helpers and wait for them before their results are read
+    stopSearch.store(true);
+
+    for (size_t i = 1; i < Threads.Size(); i++)
+        Threads.threads[i]->WaitForSearchFinished();
+
+    // Prefer a helper that completed a deeper iteration without a worse score
+    Thread* bestThread = this;
+
+    for (Thread* thread : Threads.threads)
+    {
+        if (   thread->completedDepth > bestThread->completedDepth
+            && thread->bestScore >= bestThread->bestScore
+            && thread->bestMove != MOVE_NONE)
+            bestThread = thread;
+    }
+
+    lastInfo.nodes    = Threads.NodesSearched();
+    lastInfo.depth    = bestThread->completedDepth;
+    lastInfo.seldepth = seldepth;
+    lastInfo.time     = elapsed();
+    lastInfo.nps      = lastInfo.nodes * 1000 / std::max<int64_t>(lastInfo.time, 1);
+    lastInfo.score    = bestThread->bestScore;
+    lastInfo.bestMove = bestThread->bestMove;
+
+    // Stopped before the first iteration completed, any legal move is better than none
+    if (lastInfo.bestMove == MOVE_NONE)
+    {
+        MoveList moveList;
+        MoveGen::generate(rootPos, moveList);
+
+        if (moveList.count)
+            lastInfo.bestMove = moveList.moves[0].move;
+    }
+
+    lastInfo.pickerNodes     = 0;
+    lastInfo.capturesSkipped = 0;
+    lastInfo.quietsSkipped   = 0;
+    lastInfo.qsearchNodes    = 0;
+    lastInfo.tbHits          = 0;
+    lastInfo.pawnProbes      = 0;
+    lastInfo.pawnHits        = 0;
+    lastInfo.materialProbes  = 0;
+    lastInfo.materialHits    = 0;
+
+    for (Thread* thread : Threads.threads)
+    {
+        lastInfo.pickerNodes     += thread->pickerNodes;
+        lastInfo.capturesSkipped += thread->capturesSkipped;
+        lastInfo.quietsSkipped   += thread->quietsSkipped;
+        lastInfo.qsearchNodes    += thread->qsearchNodes;
+        lastInfo.tbHits          += thread->tbHits;
+        lastInfo.pawnProbes      += thread->pawnTable.probes;
+        lastInfo.pawnHits        += thread->pawnTable.hits;
+        lastInfo.materialProbes  += thread->materialTable.probes;
+        lastInfo.materialHits    += thread->materialTable.hits;
+    }
+
+    if (reportInfo)
+    {
+        std::string bestMove = "bestmove " + UCI::moveToString(lastInfo.bestMove);
+
+        if (bestThread->pvLength[0] > 1 && bestThread->pv[0][0] == lastInfo.bestMove)
+            bestMove += " ponder " + UCI::moveToString(bestThread->pv[0][1]);
+
+        UCI::send(bestMove);
+    }
+}
+
+namespace Search {
+
+namespace {  // anonymous namespace
+
+// Searches with a narrow window around the score of the previous iteration and
+// widens the failing side of the window until the score falls inside of it.
+int aspirationSearch(Thread& thread, Position& pos, int depth, int prevScore)
+{
+    int delta = 25;
+    int alpha = -VALUE_INFINITE;
+    int beta  =  VALUE_INFINITE;
+
+    // The first iterations are too unstable for a narrow window to pay off
+    if (depth >= 4)
+    {
+        alpha = std::max(prevScore - delta, -VALUE_INFINITE);
+        beta  = std::min(prevScore + delta,  VALUE_INFINITE);
+    }
+
+    while (true)
+    {
+        int score = search(thread, pos, alpha, beta, depth, 0, true);
+
+        if (stopSearch.load(std::memory_order_relaxed))
+            return score;
+
+        if (score <= alpha)
+        {
+            beta  = (alpha + beta) / 2;
+            alpha = std::max(score - delta, -VALUE_INFINITE);
+        }
+
+        else if (score >= beta)
+            beta = std::min(score + delta, VALUE_INFINITE);
+
+        else
+            return score;
+
+        delta += delta;
+    }
+}
+
+// Alpha-beta search in its principal variation search form. The first move is searched
+// with the full window, the rest with a null window to prove that they are worse, and
+// only the moves that fail that proof are searched again with the full window.
+int search(Thread& thread, Position& pos, int alpha, int beta, int depth, int ply, bool pvNode)
+{
+    if (depth <= 0)
+        return quiescence(thread, pos, alpha, beta, ply, pvNode);
+
+    thread.pvLength[ply] = ply;
+
+    // Only the owner writes the counter, so a relaxed load and store is enough
+    uint64_t nodes = thread.nodes.load(std::memory_order_relaxed) + 1;
+    thread.nodes.store(nodes, std::memory_order_relaxed);
+
+    if (thread.id == 0 && nodes % CHECK_INTERVAL == 0)
+        checkLimits(thread);
+
+    bool rootNode = (ply == 0);
+
+    if (stopSearch.load(std::memory_order_relaxed))
+        return VALUE_ZERO;
+
+    thread.seldepth = std::max(thread.seldepth, ply + 1);
+
+    if (!rootNode)
+    {
+        if (pos.FiftyMoveCounter() >= 100 || pos.IsRepetition(ply))
+            return VALUE_DRAW;
+
+        if (ply >= MAX_PLY - 1)
+            return Eval::evaluate(pos, thread.pawnTable, thread.materialTable);
+
+        // Mate distance pruning, no line can do better than mating at the next ply
+        alpha = std::max(matedIn(ply), alpha);
+        beta  = std::min(mateIn(ply + 1), beta);
+
+        if (alpha >= beta)
+            return alpha;
+
+        // The tablebases know the exact result, so there is nothing left to search
+        if (popCount(pos.Pieces()) <= Tablebases::maxPieces())
+        {
+            int tbScore = Tablebases::probe(pos, ply);
+
+            if (tbScore != VALUE_NONE)
+            {
+                thread.tbHits++;
+                return tbScore;
+            }
+        }
+    }
+
+    Key key = pos.PositionKey();
+    TTData ttData;
+    bool ttHit   = TT.Probe(key, ttData);
+    int ttScore  = (ttHit ? valueFromTT(ttData.score, ply) : VALUE_NONE);
+    Move ttMove  = (ttHit ? ttData.move : MOVE_NONE);
+
+    if (   !pvNode
+        && ttHit
+        && ttData.depth >= depth
+        && (ttData.bound & (ttScore >= beta ? BOUND_LOWER : BOUND_UPPER)))
+        return ttScore;
+
+    bool inCheck = pos.Checkers();
+
+    // Check extension
+    if (inCheck)
+        depth++;
+
+    MovePicker movePicker(pos, ttMove, thread.killers[ply], thread.history);
+    PosInfo posInfo;
+    int bestScore = -VALUE_INFINITE;
+    Move bestMove = MOVE_NONE;
+    Move move;
+    int moveCount = 0;
+    Move quietsSearched[64];
+    int quietCount = 0;
+
+    while ((move = movePicker.NextMove()) != MOVE_NONE)
+    {
+        bool quiet = isQuiet(pos, move);
+        int score;
+
+        moveCount++;
+
+        TT.Prefetch(pos.KeyAfter(move));
+        pos.MakeMove(move, posInfo);
+
+        if (moveCount == 1)
+            score = -search(thread, pos, -beta, -alpha, depth - 1, ply + 1, pvNode);
+
+        else
+        {
+            score = -search(thread, pos, -alpha - 1, -alpha, depth - 1, ply + 1, false);
+
+            if (pvNode && score > alpha && score < beta)
+                score = -search(thread, pos, -beta, -alpha, depth - 1, ply + 1, true);
+        }
+
+        pos.UndoMove(move);
+
+        if (stopSearch.load(std::memory_order_relaxed))
+            return VALUE_ZERO;
+
+        if (score > bestScore)
+        {
+            bestScore = score;
+
+            if (score > alpha)
+            {
+                bestMove = move;
+
+                if (pvNode)
+                    updatePV(thread, ply, move);
+
+                if (score >= beta)
+                {
+                    if (quiet)
+                        updateQuietStats(thread, pos, ply, depth, move, quietsSearched, quietCount);
+
+                    break;
+                }
+
+                alpha = score;
+            }
+        }
+
+        if (quiet && quietCount < 64)
+            quietsSearched[quietCount++] = move;
+    }
+
+    thread.pickerNodes++;
+    thread.capturesSkipped += !movePicker.GeneratedCaptures();
+    thread.quietsSkipped   += !movePicker.GeneratedQuiets();
+
+    if (moveCount == 0)
+        return (inCheck ? matedIn(ply) : VALUE_DRAW);
+
+    Bound bound = BOUND_UPPER;
+
+    if (bestScore >= beta)
+        bound = BOUND_LOWER;
+
+    else if (pvNode && bestMove != MOVE_NONE)
+        bound = BOUND_EXACT;
+
+    TT.Store(key, bestMove, valueToTT(bestScore, ply), VALUE_NONE, depth, bound);
+
+    return bestScore;
+}
+
+// Searches the captures until the position is quiet, so that the static evaluation is not taken
+// in the middle of an exchange. The side to move can stand pat with the static evaluation instead
+// of capturing, unless it is in check, where all evasions are searched to find the mates.
+int quiescence(Thread& thread, Position& pos, int alpha, int beta, int ply, bool pvNode)
+{
+    thread.pvLength[ply] = ply;
+
+    uint64_t nodes = thread.nodes.load(std::memory_order_relaxed) + 1;
+    thread.nodes.store(nodes, std::memory_order_relaxed);
+    thread.qsearchNodes++;
+
+    if (thread.id == 0 && nodes % CHECK_INTERVAL == 0)
+        checkLimits(thread);
+
+    if (stopSearch.load(std::memory_order_relaxed))
+        return VALUE_ZERO;
+
+    thread.seldepth = std::max(thread.seldepth, ply + 1);
+
+    bool inCheck = pos.Checkers();
+
+    if (ply >= MAX_PLY - 1)
+        return inCheck ? VALUE_DRAW : Eval::evaluate(pos, thread.pawnTable, thread.materialTable);
+
+    Key key = pos.PositionKey();
+    TTData ttData;
+    bool ttHit  = TT.Probe(key, ttData);
+    int ttScore = (ttHit ? valueFromTT(ttData.score, ply) : VALUE_NONE);
+    Move ttMove = (ttHit ? ttData.move : MOVE_NONE);
+
+    if (   !pvNode
+        && ttHit
+        && ttData.depth >= DEPTH_QS
+        && (ttData.bound & (ttScore >= beta ? BOUND_LOWER : BOUND_UPPER)))
+        return ttScore;
+
+    int standPat  = -VALUE_INFINITE;
+    int bestScore = -VALUE_INFINITE;
+
+    if (!inCheck)
+    {
+        standPat = bestScore = Eval::evaluate(pos, thread.pawnTable, thread.materialTable);
+
+        if (standPat >= beta)
+            return standPat;
+
+        alpha = std::max(alpha, standPat);
+    }
+
+    MovePicker movePicker(pos, ttMove, thread.history);
+    PosInfo posInfo;
+    Move bestMove = MOVE_NONE;
+    Move move;
+    int moveCount = 0;
+
+    while ((move = movePicker.NextMove()) != MOVE_NONE)
+    {
+        moveCount++;
+
+        if (!inCheck)
+        {
+            PieceType victim = (getMoveType(move) == EN_PASSANT ? PAWN : getType(pos.PieceOn(getToSquare(move))));
+
+            if (getMoveType(move) != PROMOTION && standPat + PieceValue[victim] + DELTA_MARGIN <= alpha)
+                continue;
+
+            // A capture that loses material cannot do better than standing pat
+            if (!pos.SEE_GE(move))
+                continue;
+        }
+
+        TT.Prefetch(pos.KeyAfter(move));
+        pos.MakeMove(move, posInfo);
+        int score = -quiescence(thread, pos, -beta, -alpha, ply + 1, pvNode);
+        pos.UndoMove(move);
+
+        if (stopSearch.load(std::memory_order_relaxed))
+            return VALUE_ZERO;
+
+        if (score > bestScore)
+        {
+            bestScore = score;
+
+            if (score > alpha)
+            {
+                bestMove = move;
+
+                if (pvNode)
+                    updatePV(thread, ply, move);
+
+                if (score >= beta)
+                    break;
+
+                alpha = score;
+            }
+        }
+    }
+
+    // Every evasion was searched, so no move means mate
+    if (inCheck && moveCount == 0)
+        return matedIn(ply);
+
+    Bound bound = (bestScore >= beta ? BOUND_LOWER : pvNode && bestMove != MOVE_NONE ? BOUND_EXACT : BOUND_UPPER);
+
+    TT.Store(key, bestMove, valueToTT(bestScore, ply), VALUE_NONE, DEPTH_QS, bound);
+
+    return bestScore;
+}
+
+void checkLimits(const Thread& thread)
+{
+    // The clock is always enforced, even in the first iteration. IterativeDeepening falls back to
+    // the first legal move when it is interrupted, so there is still a move to play.
+    if (   (limits.movetime && elapsed() >= limits.movetime)
+        || Time.HardLimitReached())
+        stopSearch.store(true);
+
+    // A node limit costs nothing on the clock, so the first iteration is completed for a real move
+    if (thread.completedDepth > 0 && limits.nodes && Threads.NodesSearched() >= limits.nodes)
+        stopSearch.store(true);
+}
+
+// The PV of this ply is the move followed by the PV of the next ply
+void updatePV(Thread& thread, int ply, Move move)
+{
+    thread.pv[ply][ply] = move;
+
+    for (int i = ply + 1; i < thread.pvLength[ply + 1]; i++)
+        thread.pv[ply][i] = thread.pv[ply + 1][i];
+
+    thread.pvLength[ply] = std::max(thread.pvLength[ply + 1], ply + 1);
+}
+
+// The quiet move that caused a cutoff becomes a killer and gains history,
+// the quiet moves searched before it without a cutoff lose history
+void updateQuietStats(Thread& thread, const Position& pos, int ply, int depth, Move move, const Move quietsSearched[], int quietCount)
+{
+    Color us  = pos.SideToMove();
+    int bonus = std::min(depth * depth, 1024);
+
+    if (thread.killers[ply][0] != move)
+    {
+        thread.killers[ply][1] = thread.killers[ply][0];
+        thread.killers[ply][0] = move;
+    }
+
+    thread.history.Update(us, move, bonus);
+
+    for (int i = 0; i < quietCount; i++)
+        thread.history.Update(us, quietsSearched[i], -bonus);
+}
+
+void printIteration(const Thread& thread, int depth, int score)
+{
+    int64_t time   = elapsed();
+    uint64_t nodes = Threads.NodesSearched();
+    std::ostringstream oss;
+
+    oss << "info depth " << depth
+        << " seldepth "  << thread.seldepth
+        << " score "     << scoreToString(score)
+        << " nodes "     << nodes
+        << " nps "       << nodes * 1000 / std::max<int64_t>(time, 1)
+        << " hashfull "  << TT.Hashfull()
+        << " time "      << time
+        << " pv";
+
+    for (int i = 0; i < thread.pvLength[0]; i++)
+        oss << " " << UCI::moveToString(thread.pv[0][i]);
+
+    UCI::send(oss.str());
+}
+
+std::string scoreToString(int score)
+{
+    if (score >= VALUE_MATE_IN_MAX_PLY)
+        return "mate " + std::to_string((VALUE_MATE - score + 1) / 2);
+
+    if (score <= VALUE_MATED_IN_MAX_PLY)
+        return "mate " + std::to_string(-(VALUE_MATE + score) / 2);
+
+    return "cp " + std::to_string(score);
+}
+
+int64_t elapsed()
+{
+    return Time.Elapsed();
+}
+
+// Mate scores are stored relative to the position instead of the root
+// so that they stay correct when the entry is found at another ply
+inline int valueToTT(int value, int ply)
+{
+    return value >= VALUE_MATE_IN_MAX_PLY  ? value + ply
+         : value <= VALUE_MATED_IN_MAX_PLY ? value - ply
+                                           : value;
+}
+
+inline int valueFromTT(int value, int ply)
+{
+    return value >= VALUE_MATE_IN_MAX_PLY  ? value - ply
+         : value <= VALUE_MATED_IN_MAX_PLY ? value + ply
+                                           : value;
+}
+
+} // anonymous namespace
 
+} // namespace Search
 
-} // namespace ChessEngine
\ No newline at end of file
+} // namespace ChessEngine
@@ -1,14 +1,82 @@
 #ifndef SEARCH_INCLUDED
 #define SEARCH_INCLUDED
 
+#include <cstdint>
+
+#include "defs.h"
+
 namespace ChessEngine {
 
+class Position;
+
 namespace Search {
 
+// The conditions that end a search, a value of 0 means no limit
+struct Limits
+{
+    int depth = 0;
+    uint64_t nodes = 0;
+    int64_t movetime = 0;
+
+    // Searches until stopped, the bestmove is held back until then even when the search ends earlier
+    bool infinite = false;
+
+    // The clock of each side and the increment per move in milliseconds, and the moves until the
+    // next time control, 0 for the rest of the game. The time manager sets the time of the move from them.
+    int64_t time[NUM_COLORS] = {};
+    int64_t inc[NUM_COLORS] = {};
+    int movestogo = 0;
+
+    // Time passes with the nodes searched instead of the wall clock, at this many nodes per millisecond.
+    // Makes the use of the clock reproducible and independent of the machine for simulated games.
+    uint64_t nodesPerMs = 0;
+};
+
+// Statistics of the most recent search
+struct Info
+{
+    uint64_t nodes;
+    int depth;
+    int seldepth;
+    int64_t time;
+    uint64_t nps;
+    int score;
+    Move bestMove;
+
+    // Nodes where the move picker was used and how many of them
+    // cut off before the captures or the quiets were generated
+    uint64_t pickerNodes;
+    uint64_t capturesSkipped;
+    uint64_t quietsSkipped;
+
+    // Nodes searched by the quiescence search, included in nodes
+    uint64_t qsearchNodes;
+
+    // Nodes scored by the tablebases
+    uint64_t tbHits;
+
+    // Probes of the pawn and material tables and how many of them were hits
+    uint64_t pawnProbes;
+    uint64_t pawnHits;
+    uint64_t materialProbes;
+    uint64_t materialHits;
+};
+
+// Starts searching the position on the thread pool and returns immediately. With printInfo
+// the search sends its iterations and its bestmove to the GUI once it ends.
+void start(const Position& pos, const Limits& limits, bool printInfo = true);
+
+// Searches the position with iterative deepening until one of the limits is reached
+// and returns the best move of the last completed iteration
+Move go(const Position& pos, const Limits& limits, bool printInfo = true);
+
+// Makes a running search return as soon as possible
+void stop();
 
+const Info& info();
 
 } // namespace Search
 
 } // namespace ChessEngine
 
-#endif // SEARCH_INCLUDED
\ No newline at end of file
+#endif // SEARCH_INCLUDED
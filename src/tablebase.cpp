@@ -0,0 +1,388 @@
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#include "tablebase.h"
+#include "misc.h"
+#include "position.h"
+
+namespace ChessEngine {
+
+namespace Tablebases {
+
+namespace {  // anonymous namespace
+
+// The squares of the white king without pawns, every other square is a mirror image of one of them
+constexpr Square TriangleSquares[] = { A1, B1, C1, D1, B2, C2, D2, C3, D3, D4 };
+constexpr int NUM_TRIANGLE_SQUARES = 10;
+
+constexpr std::array<int, NUM_SQUARES> initTriangleIndices()
+{
+    std::array<int, NUM_SQUARES> indices{};
+
+    for (int sq = A1; sq < NUM_SQUARES; sq++)
+        indices[sq] = -1;
+
+    for (int i = 0; i < NUM_TRIANGLE_SQUARES; i++)
+        indices[TriangleSquares[i]] = i;
+
+    return indices;
+}
+
+constexpr std::array<int, NUM_SQUARES> TriangleIndex = initTriangleIndices();
+
+// The board symmetries, applied in this order. Pawns only allow mirroring the files.
+enum Symmetry
+{
+    FLIP_FILE     = 1,
+    FLIP_RANK     = 2,
+    FLIP_DIAGONAL = 4
+};
+
+constexpr Square transform(Square square, int symmetry)
+{
+    if (symmetry & FLIP_FILE)
+        square = Square(square ^ 7);
+
+    if (symmetry & FLIP_RANK)
+        square = Square(square ^ 56);
+
+    if (symmetry & FLIP_DIAGONAL)
+        square = Square(((square & 7) << 3) | (square >> 3));
+
+    return square;
+}
+
+constexpr int PAWN_SQUARES = 48;
+
+inline int pieceDomain(Piece piece)
+{
+    return getType(piece) == PAWN ? PAWN_SQUARES : NUM_SQUARES;
+}
+
+Table tables[MAX_TABLES];
+int tableCount;
+int loadedMaxPieces;
+
+// The loaded tables by material key, for either color being the stronger side
+struct Slot
+{
+    Key key;
+    const Table* table;
+    Color strongSide;
+};
+
+constexpr int NUM_SLOTS = 2 * MAX_TABLES;
+Slot slots[NUM_SLOTS];
+
+constexpr PieceType NamedTypes[] = { QUEEN, ROOK, BISHOP, KNIGHT, PAWN };
+constexpr char TypeToChar[] = " PNBRQK";
+
+void addTable(std::initializer_list<PieceType> strong, std::initializer_list<PieceType> weak)
+{
+    Table& table = tables[tableCount++];
+    std::string name = "K";
+
+    table = Table();
+    table.pieces[table.numPieces++] = WHITE_KING;
+    table.pieces[table.numPieces++] = BLACK_KING;
+
+    for (PieceType pt : strong)
+    {
+        table.pieces[table.numPieces++] = getPiece(pt, WHITE);
+        name += TypeToChar[pt];
+    }
+
+    name += "K";
+
+    for (PieceType pt : weak)
+    {
+        table.pieces[table.numPieces++] = getPiece(pt, BLACK);
+        name += TypeToChar[pt];
+    }
+
+    std::strncpy(table.name, name.c_str(), sizeof(table.name) - 1);
+
+    table.numEntries = (std::find(strong.begin(), strong.end(), PAWN) != strong.end()
+                     || std::find(weak.begin(),   weak.end(),   PAWN) != weak.end()) ? 32 : NUM_TRIANGLE_SQUARES;
+    table.hasPawns   = (table.numEntries == 32);
+    table.numEntries *= NUM_SQUARES * 2;
+
+    for (int i = 2; i < table.numPieces; i++)
+        table.numEntries *= pieceDomain(table.pieces[i]);
+
+    // Only the piece counts matter for the material key, so the squares are arbitrary
+    Position pos;
+    PosInfo posInfo;
+    Piece pieces[MAX_PIECES];
+    Square squares[MAX_PIECES];
+
+    for (Color strongSide : { WHITE, BLACK })
+    {
+        for (int i = 0; i < table.numPieces; i++)
+        {
+            Color color = getColor(table.pieces[i]);
+
+            pieces[i]  = getPiece(getType(table.pieces[i]), strongSide == WHITE ? color : ~color);
+            squares[i] = Square(A4 + 2 * i);
+        }
+
+        table.materialKey[strongSide] = pos.Set(pieces, squares, table.numPieces, WHITE, &posInfo).MaterialKey();
+    }
+}
+
+// Every table comes after the ones its captures lead to, which have fewer pieces, and
+// after the ones its promotions lead to, which have the same pieces with one pawn less
+void initTables()
+{
+    if (tableCount)
+        return;
+
+    for (PieceType pt : NamedTypes)
+        addTable({pt}, {});
+
+    for (int pawns = 0; pawns <= 2; pawns++)
+    {
+        for (int i = 0; i < 5; i++)
+        {
+            for (int j = i; j < 5; j++)
+            {
+                PieceType pt = NamedTypes[i], pt2 = NamedTypes[j];
+
+                if ((pt == PAWN) + (pt2 == PAWN) != pawns)
+                    continue;
+
+                addTable({pt, pt2}, {});
+                addTable({pt}, {pt2});
+            }
+        }
+    }
+}
+
+void release()
+{
+    for (int i = 0; i < tableCount; i++)
+    {
+        if (tables[i].mapping)
+            unmapFile(tables[i].mapping, tables[i].mappingSize);
+
+        tables[i].entries = nullptr;
+        tables[i].mapping = nullptr;
+    }
+
+    for (Slot& slot : slots)
+        slot = Slot();
+
+    loadedMaxPieces = 0;
+}
+
+bool load(Table& table, const std::string& directory)
+{
+    size_t size = 0;
+    void* data = mapFile(fileName(directory, table), size);
+
+    if (!data)
+        return false;
+
+    const FileHeader* header = static_cast<const FileHeader*>(data);
+
+    if (   size != sizeof(FileHeader) + table.numEntries
+        || std::memcmp(header->magic, FILE_MAGIC, sizeof(FILE_MAGIC))
+        || header->version    != FILE_VERSION
+        || header->numEntries != table.numEntries
+        || std::strncmp(header->name, table.name, sizeof(table.name)))
+    {
+        unmapFile(data, size);
+        return false;
+    }
+
+    table.mapping     = data;
+    table.mappingSize = size;
+    table.entries     = reinterpret_cast<const uint8_t*>(header + 1);
+
+    for (Color strongSide : { WHITE, BLACK })
+    {
+        Key key = table.materialKey[strongSide];
+        int i = int(key % NUM_SLOTS);
+
+        // Both keys are the same when the sides have the same pieces
+        while (slots[i].table && slots[i].key != key)
+            i = (i + 1) % NUM_SLOTS;
+
+        slots[i] = { key, &table, strongSide };
+    }
+
+    loadedMaxPieces = std::max(loadedMaxPieces, table.numPieces);
+
+    return true;
+}
+
+const Slot* findSlot(Key key)
+{
+    int i = int(key % NUM_SLOTS);
+
+    while (slots[i].table)
+    {
+        if (slots[i].key == key)
+            return &slots[i];
+
+        i = (i + 1) % NUM_SLOTS;
+    }
+
+    return nullptr;
+}
+
+uint64_t transformedIndex(const Table& table, const Square squares[], Color sideToMove, int symmetry)
+{
+    Square sq[MAX_PIECES];
+
+    for (int i = 0; i < table.numPieces; i++)
+        sq[i] = transform(squares[i], symmetry);
+
+    // Two identical pieces are always the last two, the lower square goes first
+    if (table.numPieces == 4 && table.pieces[2] == table.pieces[3] && sq[2] > sq[3])
+        std::swap(sq[2], sq[3]);
+
+    uint64_t idx = (table.hasPawns ? getRank(sq[0]) * 4 + getFile(sq[0]) : TriangleIndex[sq[0]]);
+    idx = idx * NUM_SQUARES + sq[1];
+
+    for (int i = 2; i < table.numPieces; i++)
+        idx = idx * pieceDomain(table.pieces[i]) + (getType(table.pieces[i]) == PAWN ? sq[i] - A2 : sq[i]);
+
+    return idx * 2 + sideToMove;
+}
+
+} // anonymous namespace
+
+int init(const std::string& directory)
+{
+    initTables();
+    release();
+
+    int loaded = 0;
+
+    for (int i = 0; i < tableCount; i++)
+        loaded += load(tables[i], directory);
+
+    return loaded;
+}
+
+int maxPieces()
+{
+    return loadedMaxPieces;
+}
+
+int numTables()
+{
+    initTables();
+    return tableCount;
+}
+
+Table& table(int i)
+{
+    return tables[i];
+}
+
+std::string fileName(const std::string& directory, const Table& table)
+{
+    return directory + "/" + table.name + FILE_EXTENSION;
+}
+
+uint64_t index(const Table& table, const Square squares[], Color sideToMove)
+{
+    Square whiteKing = squares[0];
+    int symmetry = (getFile(whiteKing) >= FILE_E ? FLIP_FILE : 0);
+
+    if (table.hasPawns)
+        return transformedIndex(table, squares, sideToMove, symmetry);
+
+    if (getRank(whiteKing) >= RANK_5)
+        symmetry |= FLIP_RANK;
+
+    whiteKing = transform(whiteKing, symmetry);
+
+    if (int(getRank(whiteKing)) > int(getFile(whiteKing)))
+        symmetry |= FLIP_DIAGONAL;
+
+    uint64_t idx = transformedIndex(table, squares, sideToMove, symmetry);
+
+    // The mirror image along the diagonal has the king on the same square
+    if (int(getRank(whiteKing)) == int(getFile(whiteKing)))
+        idx = std::min(idx, transformedIndex(table, squares, sideToMove, symmetry | FLIP_DIAGONAL));
+
+    return idx;
+}
+
+void decode(const Table& table, uint64_t index, Square squares[], Color& sideToMove)
+{
+    sideToMove = Color(index & 1);
+    index /= 2;
+
+    for (int i = table.numPieces - 1; i >= 2; i--)
+    {
+        int domain = pieceDomain(table.pieces[i]);
+        int value  = int(index % domain);
+
+        squares[i] = Square(getType(table.pieces[i]) == PAWN ? value + A2 : value);
+        index /= domain;
+    }
+
+    squares[1] = Square(index % NUM_SQUARES);
+    index /= NUM_SQUARES;
+
+    squares[0] = (table.hasPawns ? createSquare(File(index % 4), Rank(index / 4)) : TriangleSquares[index]);
+}
+
+uint8_t probeDTM(const Position& pos)
+{
+    if (   popCount(pos.Pieces()) > loadedMaxPieces
+        || pos.CastlingRights()
+        || pos.EnpassantSquare() != NO_SQUARE)
+        return NOT_FOUND;
+
+    const Slot* slot = findSlot(pos.MaterialKey());
+
+    if (!slot)
+        return NOT_FOUND;
+
+    const Table& table = *slot->table;
+    Square squares[MAX_PIECES];
+    Bitboard taken = 0;
+
+    // Flips the board when black is the stronger side, so that the table sees it as white
+    for (int i = 0; i < table.numPieces; i++)
+    {
+        Piece piece = table.pieces[i];
+        Color color = (slot->strongSide == WHITE ? getColor(piece) : ~getColor(piece));
+        Square sq   = firstSquare(pos.Pieces(getType(piece), color) & ~taken);
+
+        taken |= sq;
+        squares[i] = relativeSquare(sq, slot->strongSide);
+    }
+
+    Color sideToMove = (slot->strongSide == WHITE ? pos.SideToMove() : ~pos.SideToMove());
+
+    return table.entries[index(table, squares, sideToMove)];
+}
+
+int probe(const Position& pos, int ply)
+{
+    uint8_t dtm = probeDTM(pos);
+
+    if (dtm == NOT_FOUND)
+        return VALUE_NONE;
+
+    if (dtm == DRAW)
+        return VALUE_DRAW;
+
+    // Beyond the ply limit a mate score cannot be told apart from the shorter ones, so the
+    // score only says which side wins and the search keeps looking for a shorter mate
+    if (ply + dtm >= MAX_PLY)
+        return (dtm & 1) ? VALUE_MATE_IN_MAX_PLY - 1 : VALUE_MATED_IN_MAX_PLY + 1;
+
+    return (dtm & 1) ? mateIn(ply + dtm) : matedIn(ply + dtm);
+}
+
+} // namespace Tablebases
+
+} // namespace ChessEngine
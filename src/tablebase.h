@@ -0,0 +1,103 @@
+#ifndef TABLEBASE_INCLUDED
+#define TABLEBASE_INCLUDED
+
+#include <string>
+
+#include "defs.h"
+
+namespace ChessEngine {
+
+class Position;
+
+namespace Tablebases {
+
+// Every ending of up to MAX_PIECES pieces, kings included, has a table
+constexpr int MAX_PIECES = 4;
+constexpr int MAX_TABLES = 64;
+
+constexpr const char* DEFAULT_DIRECTORY = "tablebases";
+constexpr const char* FILE_EXTENSION    = ".cetb";
+
+// Every position has an entry of one byte, the distance to mate in plies from the side to move's
+// point of view: odd if the side to move mates and even if it is mated, 0 being checkmate.
+// Positions that cannot occur are stored as draws.
+constexpr uint8_t DRAW      = 255;
+constexpr uint8_t NOT_FOUND = 254;
+constexpr uint8_t MAX_DTM   = 251;
+
+// A table file is the header followed by the entries, indexed by index()
+struct FileHeader
+{
+    char magic[4];
+    uint32_t version;
+    char name[8];
+    uint64_t numEntries;
+    uint32_t maxDtm;
+    uint32_t reserved[9];
+};
+
+constexpr char FILE_MAGIC[4]    = {'C', 'E', 'T', 'B'};
+constexpr uint32_t FILE_VERSION = 2;
+
+// An ending such as KQKR, named with the pieces of the stronger side first. The table is stored
+// with the stronger side as white, positions with the colors the other way around are flipped.
+//
+// The pieces are the white king, the black king and then the other pieces in the order of
+// the name. The white king is mirrored into the triangle a1-d1-d4 without pawns and onto
+// the files a to d with pawns, pawns only have the 48 squares of the ranks 2 to 7.
+struct Table
+{
+    char name[8];
+    int numPieces;
+    Piece pieces[MAX_PIECES];
+    bool hasPawns;
+    uint64_t numEntries;
+
+    // Of the table as named and with the colors swapped
+    Key materialKey[NUM_COLORS];
+
+    // The memory mapped file, if it is loaded
+    const uint8_t* entries;
+    void* mapping;
+    size_t mappingSize;
+};
+
+// Maps the table files found in the directory and returns how many there are,
+// the tables that are not found or not valid are left out
+int init(const std::string& directory);
+
+// The most pieces of a loaded table, 0 if none are loaded
+int maxPieces();
+
+// The entry of the position, or NOT_FOUND if there is no table for it. Positions with
+// castling or en passant rights are not in the tables. Allocates nothing.
+uint8_t probeDTM(const Position& pos);
+
+// The search score of the position at the given ply from the tablebases, or VALUE_NONE
+int probe(const Position& pos, int ply);
+
+// Generates the table files of every ending into the directory, the ones
+// that are found already are kept. Prints the time and the size of every table.
+void generate(const std::string& directory, int numThreads);
+
+// Used by the generator
+
+// All the 3 and 4 piece endings, every one after the endings it can convert into
+int numTables();
+Table& table(int i);
+
+std::string fileName(const std::string& directory, const Table& table);
+
+// The index of the entry of the pieces in the order of the table, with white as the stronger side.
+// All the positions that are mirror images of each other, or that only differ by which of two
+// identical pieces is where, share the same index.
+uint64_t index(const Table& table, const Square squares[], Color sideToMove);
+
+// The pieces of the entry, the inverse of index() for the positions it returns
+void decode(const Table& table, uint64_t index, Square squares[], Color& sideToMove);
+
+} // namespace Tablebases
+
+} // namespace ChessEngine
+
+#endif // TABLEBASE_INCLUDED
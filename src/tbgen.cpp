@@ -0,0 +1,585 @@
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <filesystem>
+#include <cstring>
+
+#include "tablebase.h"
+#include "movegen.h"
+#include "position.h"
+
+namespace ChessEngine {
+
+namespace Tablebases {
+
+namespace {  // anonymous namespace
+
+// States of an entry during the generation, stored as draws in the file
+constexpr uint8_t UNKNOWN = 253;
+constexpr uint8_t ILLEGAL = 252;
+
+// The captures and promotions of a position lead into other tables, which are already done.
+// Their best outcome is kept: a win, a draw or otherwise the longest of the losses.
+constexpr uint8_t EXIT_NONE = 0;
+constexpr uint8_t EXIT_DRAW = 254;
+constexpr uint8_t EXIT_WIN  = 255;
+
+// The positions are processed in chunks of this many, handed out to the threads in turn
+constexpr uint64_t CHUNK_SIZE = 16384;
+
+// Entries sorted by the distance to mate of their value
+using IndexLists = std::vector<std::vector<uint32_t>>;
+
+struct Stats
+{
+    uint64_t wins;
+    uint64_t losses;
+    uint64_t draws;
+    int maxDtm;
+};
+
+// Retrograde analysis with a counter of the unresolved moves of every position. A position
+// is won as soon as one of its moves reaches a lost position, and lost once all of its moves
+// reached won positions. The lost and won positions are taken in the order of their distance
+// to mate, so the first time a position is resolved is with its shortest win or longest loss.
+// Only quiet moves stay inside of the table, so the moves are easily taken back from a position
+// to find its predecessors. See: https://www.chessprogramming.org/Retrograde_Analysis
+//
+// With pawns of both colors, a double push that can be captured en passant does not lead to the
+// entry with the same board: the en passant capture is one more move. It leads to an en passant
+// node after the entries instead, which has the moves of the entry and the captures on top. The
+// nodes are resolved from their entry and their captures, and are not written to the file.
+class Generator {
+public:
+    Generator(const Table& table, int numThreads)
+        : table(table),
+          numThreads(numThreads),
+          enpassant(hasEnpassant(table)),
+          numNodes(table.numEntries * (enpassant ? 2 : 1)),
+          results(new std::atomic<uint8_t>[numNodes]),
+          counts(new std::atomic<uint8_t>[numNodes]),
+          exits(new uint8_t[numNodes]),
+          exitWins(MAX_DTM + 1),
+          resolved(MAX_DTM + 1),
+          missingTable(false)
+    {}
+
+    // Returns false if a table that a capture or a promotion leads to is not loaded
+    bool Run();
+    bool Write(const std::string& path, Stats& stats) const;
+
+private:
+    static bool hasEnpassant(const Table& table);
+
+    void Classify(uint64_t idx, Position& pos, PosInfo posInfos[], IndexLists& found);
+    bool ClassifyEnpassant(uint32_t entry, Position& pos, PosInfo& captureInfo, IndexLists& found);
+    void ScoreExit(Position& pos, Move move, PosInfo& posInfo, int& winIn, int& lossIn, bool& draw);
+    void Propagate(uint32_t idx, int dtm, IndexLists& found);
+    int Predecessors(uint32_t idx, uint32_t predecessors[]) const;
+
+    uint32_t EnpassantNode(uint32_t entry) const { return uint32_t(table.numEntries + entry); }
+    bool HasEnpassantNode(uint32_t entry) const
+    {
+        return enpassant && results[EnpassantNode(entry)].load(std::memory_order_relaxed) != ILLEGAL;
+    }
+
+    // Runs the work on chunks of the indices up to size on all threads, and collects the entries
+    // that the threads found to be resolved into the lists. Work is called with the index,
+    // the thread's own Position and PosInfos and its lists.
+    template<typename Work>
+    void ParallelFor(uint64_t size, IndexLists& lists, Work work);
+
+    const Table& table;
+    int numThreads;
+    bool enpassant;
+    uint64_t numNodes;
+
+    std::unique_ptr<std::atomic<uint8_t>[]> results;
+    std::unique_ptr<std::atomic<uint8_t>[]> counts;
+    std::unique_ptr<uint8_t[]> exits;
+
+    // Positions won through a capture or a promotion, resolved unless they have a shorter win in the table
+    IndexLists exitWins;
+
+    // Positions resolved with the distance to mate, waiting for their predecessors to be updated
+    IndexLists resolved;
+
+    std::atomic<bool> missingTable;
+};
+
+template<typename Work>
+void Generator::ParallelFor(uint64_t size, IndexLists& lists, Work work)
+{
+    std::atomic<uint64_t> nextChunk(0);
+    std::vector<IndexLists> threadLists(numThreads, IndexLists(MAX_DTM + 1));
+    std::vector<std::thread> workers;
+
+    for (int id = 0; id < numThreads; id++)
+    {
+        workers.emplace_back([&, id]() {
+            Position pos;
+            PosInfo posInfos[3];
+            uint64_t begin;
+
+            while ((begin = nextChunk.fetch_add(CHUNK_SIZE)) < size)
+                for (uint64_t i = begin; i < std::min(begin + CHUNK_SIZE, size); i++)
+                    work(i, pos, posInfos, threadLists[id]);
+        });
+    }
+
+    for (std::thread& worker : workers)
+        worker.join();
+
+    for (const IndexLists& found : threadLists)
+        for (int dtm = 0; dtm <= MAX_DTM; dtm++)
+            lists[dtm].insert(lists[dtm].end(), found[dtm].begin(), found[dtm].end());
+}
+
+bool Generator::hasEnpassant(const Table& table)
+{
+    bool pawns[NUM_COLORS] = {};
+
+    for (int i = 0; i < table.numPieces; i++)
+        if (getType(table.pieces[i]) == PAWN)
+            pawns[getColor(table.pieces[i])] = true;
+
+    return pawns[WHITE] && pawns[BLACK];
+}
+
+// Makes the move that leaves the table and keeps the best outcome of the moves scored so far
+void Generator::ScoreExit(Position& pos, Move move, PosInfo& posInfo, int& winIn, int& lossIn, bool& draw)
+{
+    pos.MakeMove(move, posInfo);
+    uint8_t dtm = (popCount(pos.Pieces()) == 2 ? DRAW : probeDTM(pos));
+    pos.UndoMove(move);
+
+    if (dtm == NOT_FOUND)
+        missingTable.store(true, std::memory_order_relaxed);
+
+    else if (dtm == DRAW)
+        draw = true;
+
+    // The opponent mates or is mated in dtm plies after the move
+    else if (dtm & 1)
+        lossIn = std::max(lossIn, std::min(dtm + 1, int(MAX_DTM)));
+
+    else
+        winIn = std::min(winIn, dtm + 1);
+}
+
+// Sets up the position of the entry, counts its distinct successors in the table and scores the
+// moves that leave it. Checkmates and positions decided by leaving the table are resolved.
+void Generator::Classify(uint64_t idx, Position& pos, PosInfo posInfos[], IndexLists& found)
+{
+    Square squares[MAX_PIECES];
+    Color us;
+
+    results[idx].store(ILLEGAL, std::memory_order_relaxed);
+    counts[idx].store(0, std::memory_order_relaxed);
+    exits[idx] = EXIT_NONE;
+
+    decode(table, idx, squares, us);
+
+    for (int i = 0; i < table.numPieces; i++)
+        for (int j = i + 1; j < table.numPieces; j++)
+            if (squares[i] == squares[j])
+                return;
+
+    // Mirror images only keep the entry that index() returns
+    if (index(table, squares, us) != idx)
+        return;
+
+    pos.Set(table.pieces, squares, table.numPieces, us, &posInfos[0]);
+
+    // The side that just moved is in check
+    if (pos.AttackersTo(pos.KingSquare(~us)) & pos.Pieces(us))
+        return;
+
+    MoveList moveList;
+    MoveGen::generate(pos, moveList);
+
+    uint32_t successors[MAX_MOVES];
+    int numSuccessors = 0;
+    int winIn = MAX_DTM + 1, lossIn = 0;
+    bool draw = false;
+
+    for (int i = 0; i < moveList.count; i++)
+    {
+        Move move = moveList.moves[i].move;
+
+        if (pos.IsCapture(move) || getMoveType(move) == PROMOTION)
+        {
+            ScoreExit(pos, move, posInfos[1], winIn, lossIn, draw);
+            continue;
+        }
+
+        Square from = getFromSquare(move), to = getToSquare(move);
+        Square next[MAX_PIECES];
+        std::copy(squares, squares + table.numPieces, next);
+        *std::find(next, next + table.numPieces, from) = to;
+
+        uint32_t successor = uint32_t(index(table, next, ~us));
+
+        if (enpassant && getType(pos.PieceOn(from)) == PAWN && distance(from, to) == 2)
+        {
+            pos.MakeMove(move, posInfos[1]);
+
+            if (ClassifyEnpassant(successor, pos, posInfos[2], found))
+                successor = EnpassantNode(successor);
+
+            pos.UndoMove(move);
+        }
+
+        successors[numSuccessors++] = successor;
+    }
+
+    std::sort(successors, successors + numSuccessors);
+    numSuccessors = int(std::unique(successors, successors + numSuccessors) - successors);
+
+    results[idx].store(UNKNOWN, std::memory_order_relaxed);
+    counts[idx].store(uint8_t(numSuccessors), std::memory_order_relaxed);
+    exits[idx] = (winIn <= MAX_DTM ? EXIT_WIN : draw ? EXIT_DRAW : uint8_t(lossIn));
+
+    if (moveList.count == 0)
+    {
+        if (pos.Checkers())
+        {
+            results[idx].store(0, std::memory_order_relaxed);
+            found[0].push_back(uint32_t(idx));
+        }
+        else
+            results[idx].store(DRAW, std::memory_order_relaxed);
+    }
+
+    else if (winIn <= MAX_DTM)
+        found[winIn].push_back(uint32_t(idx));
+
+    else if (numSuccessors == 0)
+    {
+        if (draw)
+            results[idx].store(DRAW, std::memory_order_relaxed);
+        else
+        {
+            results[idx].store(uint8_t(lossIn), std::memory_order_relaxed);
+            found[lossIn].push_back(uint32_t(idx));
+        }
+    }
+}
+
+// The position after a double push, set up with its en passant square. Scores the en passant
+// captures into the node of the entry with the same board, which is resolved if the captures
+// are its only moves or one of them wins. Returns false if no capture is legal, the double push
+// then leads to the entry. Every node is only reached from one entry, so has only one writer.
+bool Generator::ClassifyEnpassant(uint32_t entry, Position& pos, PosInfo& captureInfo, IndexLists& found)
+{
+    if (pos.EnpassantSquare() == NO_SQUARE)
+        return false;
+
+    MoveList moveList;
+    MoveGen::generate(pos, moveList);
+
+    int winIn = MAX_DTM + 1, lossIn = 0, captures = 0;
+    bool draw = false;
+
+    for (int i = 0; i < moveList.count; i++)
+    {
+        Move move = moveList.moves[i].move;
+
+        if (getMoveType(move) == EN_PASSANT)
+        {
+            ScoreExit(pos, move, captureInfo, winIn, lossIn, draw);
+            captures++;
+        }
+    }
+
+    if (!captures)
+        return false;
+
+    uint32_t node = EnpassantNode(entry);
+
+    results[node].store(UNKNOWN, std::memory_order_relaxed);
+    exits[node] = (winIn <= MAX_DTM ? EXIT_WIN : draw ? EXIT_DRAW : uint8_t(lossIn));
+
+    if (winIn <= MAX_DTM)
+        found[winIn].push_back(node);
+
+    else if (captures == moveList.count)
+    {
+        if (draw)
+            results[node].store(DRAW, std::memory_order_relaxed);
+        else
+        {
+            results[node].store(uint8_t(lossIn), std::memory_order_relaxed);
+            found[lossIn].push_back(node);
+        }
+    }
+
+    return true;
+}
+
+// The positions that have a quiet move to the entry, each once even if more of their
+// moves lead to mirror images of it. An en passant node is only reached by the double push.
+int Generator::Predecessors(uint32_t idx, uint32_t predecessors[]) const
+{
+    Square squares[MAX_PIECES];
+    Color us;
+    bool enpassantNode = (idx >= table.numEntries);
+    uint32_t entry     = uint32_t(enpassantNode ? idx - table.numEntries : idx);
+
+    decode(table, entry, squares, us);
+
+    Color them = ~us;
+    Bitboard occupancy = 0;
+    int count = 0;
+
+    for (int i = 0; i < table.numPieces; i++)
+        occupancy |= squares[i];
+
+    for (int i = 0; i < table.numPieces; i++)
+    {
+        Piece piece = table.pieces[i];
+        Square to   = squares[i];
+        Bitboard froms;
+
+        if (getColor(piece) != them)
+            continue;
+
+        if (getType(piece) == PAWN)
+        {
+            Direction up = getPawnDir(them);
+            Rank rank    = relativeRank(getRank(to), them);
+
+            bool singlePush = (rank >= RANK_3 && !(occupancy & (to - up)));
+            bool doublePush = (singlePush && rank == RANK_4 && !(occupancy & (to - up - up)));
+
+            froms = 0;
+
+            if (singlePush && !enpassantNode)
+                froms |= getSquareMask(to - up);
+
+            // A double push that can be captured en passant leads to the node instead of the entry
+            if (doublePush && (enpassantNode || !HasEnpassantNode(entry)))
+                froms |= getSquareMask(to - up - up);
+        }
+        else if (!enpassantNode)
+            froms = attackMask(getType(piece), to, occupancy) & ~occupancy;
+        else
+            froms = 0;
+
+        while (froms)
+        {
+            Square previous[MAX_PIECES];
+            std::copy(squares, squares + table.numPieces, previous);
+            previous[i] = popSquare(froms);
+
+            predecessors[count++] = uint32_t(index(table, previous, them));
+        }
+    }
+
+    std::sort(predecessors, predecessors + count);
+    return int(std::unique(predecessors, predecessors + count) - predecessors);
+}
+
+// The entry is resolved with the distance to mate, so its predecessors are a move further away
+void Generator::Propagate(uint32_t idx, int dtm, IndexLists& found)
+{
+    uint32_t predecessors[2 * MAX_MOVES];
+    int count = Predecessors(idx, predecessors);
+
+    // The en passant node has the moves of the entry and the captures: it wins as the entry does,
+    // and is lost as late as the entry or the captures are if none of the captures wins or draws
+    if (idx < table.numEntries && HasEnpassantNode(idx))
+    {
+        uint32_t node = EnpassantNode(idx);
+        uint8_t exit  = exits[node];
+        uint8_t expected = UNKNOWN;
+
+        int nodeDtm = (dtm & 1) ? dtm : (exit == EXIT_WIN || exit == EXIT_DRAW) ? -1 : std::max(dtm, int(exit));
+
+        if (nodeDtm >= 0 && results[node].compare_exchange_strong(expected, uint8_t(nodeDtm)))
+            found[nodeDtm].push_back(node);
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        uint32_t prev = predecessors[i];
+        uint8_t expected = UNKNOWN;
+
+        if (results[prev].load(std::memory_order_relaxed) == ILLEGAL)
+            continue;
+
+        // The side to move is mated, so the predecessor mates with the move
+        if (!(dtm & 1))
+        {
+            if (results[prev].compare_exchange_strong(expected, uint8_t(dtm + 1)))
+                found[dtm + 1].push_back(prev);
+
+            continue;
+        }
+
+        // The last move of the predecessor is refuted, it is lost if it has no better exit
+        if (counts[prev].fetch_sub(1) != 1 || exits[prev] == EXIT_WIN || exits[prev] == EXIT_DRAW)
+            continue;
+
+        int lossIn = std::max(dtm + 1, int(exits[prev]));
+
+        if (results[prev].compare_exchange_strong(expected, uint8_t(lossIn)))
+            found[lossIn].push_back(prev);
+    }
+}
+
+bool Generator::Run()
+{
+    IndexLists found(MAX_DTM + 1);
+
+    // The en passant nodes are only created by the double pushes that reach them
+    for (uint64_t idx = table.numEntries; idx < numNodes; idx++)
+        results[idx].store(ILLEGAL, std::memory_order_relaxed);
+
+    ParallelFor(table.numEntries, found, [this](uint64_t idx, Position& pos, PosInfo posInfos[], IndexLists& lists) {
+        Classify(idx, pos, posInfos, lists);
+    });
+
+    if (missingTable)
+        return false;
+
+    // The checkmates and the losses through the exits are resolved already, the wins through
+    // the exits are only resolved at their distance if no shorter win is found before
+    for (int dtm = 0; dtm <= MAX_DTM; dtm++)
+        (dtm & 1 ? exitWins : resolved)[dtm].swap(found[dtm]);
+
+    for (int dtm = 0; dtm < MAX_DTM; dtm++)
+    {
+        for (uint32_t idx : exitWins[dtm])
+        {
+            uint8_t expected = UNKNOWN;
+
+            if (results[idx].compare_exchange_strong(expected, uint8_t(dtm)))
+                resolved[dtm].push_back(idx);
+        }
+
+        // Adds to the lists of the longer distances, and to this one only for en passant nodes,
+        // which are propagated in turn until there are none left
+        for (size_t done = 0; done < resolved[dtm].size(); )
+        {
+            std::vector<uint32_t> current(resolved[dtm].begin() + done, resolved[dtm].end());
+            done = resolved[dtm].size();
+
+            ParallelFor(current.size(), resolved, [&](uint64_t i, Position&, PosInfo[], IndexLists& lists) {
+                Propagate(current[i], dtm, lists);
+            });
+        }
+    }
+
+    return true;
+}
+
+bool Generator::Write(const std::string& path, Stats& stats) const
+{
+    std::vector<uint8_t> entries(table.numEntries);
+
+    stats = Stats();
+
+    for (uint64_t idx = 0; idx < table.numEntries; idx++)
+    {
+        uint8_t result = results[idx].load(std::memory_order_relaxed);
+
+        if (result == ILLEGAL || result == UNKNOWN || result == DRAW)
+        {
+            stats.draws += (result != ILLEGAL);
+            result = DRAW;
+        }
+        else
+        {
+            (result & 1 ? stats.wins : stats.losses)++;
+
+            // The longest mate is counted from the winning side, the loss is one ply longer
+            if (result & 1)
+                stats.maxDtm = std::max(stats.maxDtm, int(result));
+        }
+
+        entries[idx] = result;
+    }
+
+    FileHeader header = {};
+    std::memcpy(header.magic, FILE_MAGIC, sizeof(header.magic));
+    std::memcpy(header.name, table.name, sizeof(header.name));
+    header.version    = FILE_VERSION;
+    header.numEntries = table.numEntries;
+    header.maxDtm     = uint32_t(stats.maxDtm);
+
+    std::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(entries.data()), entries.size());
+
+    return bool(file);
+}
+
+} // anonymous namespace
+
+void generate(const std::string& directory, int numThreads)
+{
+    std::filesystem::create_directories(directory);
+
+    int existing = init(directory);
+    auto totalStart = std::chrono::steady_clock::now();
+    uint64_t totalSize = 0;
+
+    std::cout << "Generating " << numTables() << " tables into " << directory << " with " << numThreads
+              << " threads, " << existing << " found already\n\n";
+
+    for (int i = 0; i < numTables(); i++)
+    {
+        const Table& t = table(i);
+        std::string path = fileName(directory, t);
+
+        if (t.entries)
+        {
+            totalSize += t.mappingSize;
+            continue;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+
+        Generator generator(t, numThreads);
+        Stats stats;
+
+        if (!generator.Run())
+        {
+            std::cout << t.name << ": a table that its captures or promotions lead to is missing" << std::endl;
+            return;
+        }
+
+        if (!generator.Write(path, stats))
+        {
+            std::cout << t.name << ": could not write " << path << std::endl;
+            return;
+        }
+
+        auto stop = std::chrono::steady_clock::now();
+        uint64_t size = sizeof(FileHeader) + t.numEntries;
+        totalSize += size;
+
+        std::cout << t.name << "  Entries: " << t.numEntries << "  Wins: " << stats.wins << "  Losses: " << stats.losses
+                  << "  Draws: " << stats.draws << "  Longest mate: " << stats.maxDtm << " plies"
+                  << "  Time: " << std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count() << " ms"
+                  << "  Size: " << size / 1024 << " KB" << std::endl;
+
+        // The later tables look up their captures and promotions in this one
+        init(directory);
+    }
+
+    auto totalStop = std::chrono::steady_clock::now();
+
+    std::cout << "\nTime: " << std::chrono::duration_cast<std::chrono::milliseconds>(totalStop - totalStart).count() << " ms\n";
+    std::cout << "Size: " << totalSize / (1024 * 1024) << " MB" << std::endl;
+}
+
+} // namespace Tablebases
+
+} // namespace ChessEngine
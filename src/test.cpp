@@ -1,12 +1,38 @@
 #include <iostream>
+#include <iomanip>
 #include <sstream>
 #include <vector>
 #include <chrono>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <array>
+#include <tuple>
+#include <thread>
 
+#if !defined(_WIN32)
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 
 #include "test.h"
 #include "position.h"
+#include "movegen.h"
+#include "movepick.h"
+#include "bitboard.h"
+#include "bitbase.h"
+#include "book.h"
+#include "endgame.h"
+#include "nnue.h"
 #include "perft.h"
+#include "search.h"
+#include "tablebase.h"
+#include "timeman.h"
+#include "tt.h"
+#include "uci.h"
+#include "thread.h"
 
 namespace ChessEngine {
 
@@ -16,57 +42,592 @@ namespace Test {
 #define RED_TEXT "\033[31m"
 #define RESET_TEXT "\033[0m"
 
-void perft()
+namespace {  // anonymous namespace
+
+// Depth - nodes - fen
+const std::vector<std::string> perftCases =
 {
-    // Depth - nodes - fen
-    const std::vector<std::string> testCases =
-    {
-        "5 4865609 rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
-        "6 11030083 8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
-        "5 15587335 r3k2r/pp3pp1/PN1pr1p1/4p1P1/4P3/3P4/P1P2PP1/R3K2R w KQkq - 4 4",
-        "5 89941194 rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
-        "4 3894594 r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
-        "5 193690690 r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
-        "4 497787 r3k1nr/p2pp1pp/b1n1P1P1/1BK1Pp1q/8/8/2PP1PPP/6N1 w kq - 0 1",
-        "6 1134888 3k4/3p4/8/K1P4r/8/8/8/8 b - - 0 1",
-        "6 1440467 8/8/1k6/2b5/2pP4/8/5K2/8 b - d3 0 1",
-        "6 661072 5k2/8/8/8/8/8/8/4K2R w K - 0 1",
-        "7 15594314 3k4/8/8/8/8/8/8/R3K3 w Q - 0 1",
-        "4 1274206 r3k2r/1b4bq/8/8/8/8/7B/R3K2R w KQkq - 0 1",
-        "5 58773923 r3k2r/8/3Q4/8/8/5q2/8/R3K2R b KQkq - 0 1",
-        "6 3821001 2K2r2/4P3/8/8/8/8/8/3k4 w - - 0 1",
-        "5 1004658 8/8/1P2K3/8/2n5/1q6/8/5k2 b - - 0 1",
-        "6 217342 4k3/1P6/8/8/8/8/K7/8 w - - 0 1",
-        "6 92683 8/P1k5/K7/8/8/8/8/8 w - - 0 1",
-        "10 5966690 K1k5/8/P7/8/8/8/8/8 w - - 0 1",
-        "7 567584 8/k1P5/8/1K6/8/8/8/8 w - - 0 1",
-        "6 3114998 8/8/2k5/5q2/5n2/8/5K2/8 b - - 0 1",
-        "5 42761834 r1bq2r1/1pppkppp/1b3n2/pP1PP3/2n5/2P5/P3QPPP/RNB1K2R w KQ a6 0 12",
-        "4 3050662 r3k2r/pppqbppp/3p1n1B/1N2p3/1nB1P3/3P3b/PPPQNPPP/R3K2R w KQkq - 11 10",
-        "5 10574719 4k2r/1pp1n2p/6N1/1K1P2r1/4P3/P5P1/1Pp4P/R7 w k - 0 6",
-        "4 6871272 1Bb3BN/R2Pk2r/1Q5B/4q2R/2bN4/4Q1BK/1p6/1bq1R1rb w - - 0 1",
-        "6 71179139 n1n5/PPPk4/8/8/8/8/4Kppp/5N1N b - - 0 1",
-        "6 28859283 8/PPPk4/8/8/8/8/4Kppp/8 b - - 0 1",
-        "9 7618365 8/2k1p3/3pP3/3P2K1/8/8/8/8 w - - 0 1",
-        "4 28181 3r4/2p1p3/8/1P1P1P2/3K4/5k2/8/8 b - - 0 1",
-        "5 6323457 8/1p4p1/8/q1PK1P1r/3p1k2/8/4P3/4Q3 b - - 0 1"
-    };
+    "5 4865609 rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "6 11030083 8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "5 15587335 r3k2r/pp3pp1/PN1pr1p1/4p1P1/4P3/3P4/P1P2PP1/R3K2R w KQkq - 4 4",
+    "5 89941194 rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "4 3894594 r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    "5 193690690 r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "4 497787 r3k1nr/p2pp1pp/b1n1P1P1/1BK1Pp1q/8/8/2PP1PPP/6N1 w kq - 0 1",
+    "6 1134888 3k4/3p4/8/K1P4r/8/8/8/8 b - - 0 1",
+    "6 1440467 8/8/1k6/2b5/2pP4/8/5K2/8 b - d3 0 1",
+    "6 661072 5k2/8/8/8/8/8/8/4K2R w K - 0 1",
+    "7 15594314 3k4/8/8/8/8/8/8/R3K3 w Q - 0 1",
+    "4 1274206 r3k2r/1b4bq/8/8/8/8/7B/R3K2R w KQkq - 0 1",
+    "5 58773923 r3k2r/8/3Q4/8/8/5q2/8/R3K2R b KQkq - 0 1",
+    "6 3821001 2K2r2/4P3/8/8/8/8/8/3k4 w - - 0 1",
+    "5 1004658 8/8/1P2K3/8/2n5/1q6/8/5k2 b - - 0 1",
+    "6 217342 4k3/1P6/8/8/8/8/K7/8 w - - 0 1",
+    "6 92683 8/P1k5/K7/8/8/8/8/8 w - - 0 1",
+    "10 5966690 K1k5/8/P7/8/8/8/8/8 w - - 0 1",
+    "7 567584 8/k1P5/8/1K6/8/8/8/8 w - - 0 1",
+    "6 3114998 8/8/2k5/5q2/5n2/8/5K2/8 b - - 0 1",
+    "5 42761834 r1bq2r1/1pppkppp/1b3n2/pP1PP3/2n5/2P5/P3QPPP/RNB1K2R w KQ a6 0 12",
+    "4 3050662 r3k2r/pppqbppp/3p1n1B/1N2p3/1nB1P3/3P3b/PPPQNPPP/R3K2R w KQkq - 11 10",
+    "5 10574719 4k2r/1pp1n2p/6N1/1K1P2r1/4P3/P5P1/1Pp4P/R7 w k - 0 6",
+    "4 6871272 1Bb3BN/R2Pk2r/1Q5B/4q2R/2bN4/4Q1BK/1p6/1bq1R1rb w - - 0 1",
+    "6 71179139 n1n5/PPPk4/8/8/8/8/4Kppp/5N1N b - - 0 1",
+    "6 28859283 8/PPPk4/8/8/8/8/4Kppp/8 b - - 0 1",
+    "9 7618365 8/2k1p3/3pP3/3P2K1/8/8/8/8 w - - 0 1",
+    "4 28181 3r4/2p1p3/8/1P1P1P2/3K4/5k2/8/8 b - - 0 1",
+    "5 6323457 8/1p4p1/8/q1PK1P1r/3p1k2/8/4P3/4Q3 b - - 0 1"
+};
+
+void parseCase(const std::string& testCase, int& depth, uint64_t& expectedNodes, std::string& fen)
+{
+    std::istringstream ss(testCase);
+    char token;
+
+    ss >> depth >> expectedNodes;
+    ss >> std::noskipws >> token;
+    ss >> std::skipws;
+    std::getline(ss, fen);
+}
+
+constexpr size_t perftCacheSize = 64;
+
+// Positions for measuring the search
+const std::vector<std::string> searchCases =
+{
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "r3k2r/pppqbppp/3p1n1B/1N2p3/1nB1P3/3P3b/PPPQNPPP/R3K2R w KQkq - 11 10",
+    "r1bq2r1/1pppkppp/1b3n2/pP1PP3/2n5/2P5/P3QPPP/RNB1K2R w KQ a6 0 12",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "8/8/2k5/5q2/5n2/8/5K2/8 b - - 0 1",
+};
+
+// Long endgames, most of them with a known ending at the root or a few captures away
+const std::vector<std::string> endgameCases =
+{
+    "8/8/8/4k3/8/8/8/KQ6 w - - 0 1",
+    "8/8/8/4k3/8/8/8/KR6 w - - 0 1",
+    "8/8/8/4k3/8/8/8/KBN5 w - - 0 1",
+    "8/8/3k4/8/8/2r5/8/4KQ2 w - - 0 1",
+    "8/8/4k3/8/4P3/4K3/r7/7R w - - 0 1",
+    "8/5k2/4b3/1p1p1p2/1P1P4/4B3/5K2/8 w - - 0 1",
+    "8/5k2/8/2p1p1p1/2P1P1P1/8/5K2/8 w - - 0 1",
+    "8/8/8/4k3/8/8/4P3/4K3 w - - 0 1",
+};
+
+// Writes a network with random weights, which is enough to measure and verify the accumulators
+bool writeRandomNetwork(const std::string& path)
+{
+    std::mt19937 rng(1070372);
+    std::uniform_int_distribution<int> featureWeight(-32, 32), outputWeight(-64, 64);
+    std::vector<int16_t> weights(NNUE::L1_SIZE + size_t(NNUE::NUM_FEATURES) * NNUE::L1_SIZE + 2 * NNUE::L1_SIZE);
+    size_t numFeatureWeights = weights.size() - 2 * NNUE::L1_SIZE;
+    int32_t outputBias = 1000;
+
+    for (size_t i = 0; i < weights.size(); i++)
+        weights[i] = int16_t(i < numFeatureWeights ? featureWeight(rng) : outputWeight(rng));
+
+    NNUE::FileHeader header = {};
+    std::memcpy(header.magic, NNUE::FILE_MAGIC, sizeof(header.magic));
+    header.version     = NNUE::FILE_VERSION;
+    header.numFeatures = NNUE::NUM_FEATURES;
+    header.l1Size      = NNUE::L1_SIZE;
+
+    std::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(weights.data()), weights.size() * sizeof(int16_t));
+    file.write(reinterpret_cast<const char*>(&outputBias), sizeof(outputBias));
+
+    return bool(file);
+}
+
+// Expected value - move - fen, exchanges with x-rays, pins and king recaptures
+const std::vector<std::string> seeCases =
+{
+    "100 d2d5 4k3/8/8/3p4/8/8/3R4/3RK3 w - - 0 1",
+    "-400 d2d5 4k3/3r4/8/3p4/8/8/3R4/4K3 w - - 0 1",
+    "100 d2d5 4k3/3r4/8/3p4/8/8/3R4/3RK3 w - - 0 1",
+    "-220 e3d5 4k3/8/2p5/3p4/8/4N3/8/4K3 w - - 0 1",
+    "0 e3d5 4k3/8/2p5/3n4/8/4N3/8/4K3 w - - 0 1",
+    "-130 e4d5 4k3/8/2p5/3p4/4B3/5Q2/8/4K3 w - - 0 1",
+    "-800 d1d5 4k3/8/2p5/3p4/8/8/8/3QK3 w - - 0 1",
+    "100 d2d5 3k4/8/5n2/3p4/7B/8/3R4/4K3 w - - 0 1",
+    "-400 d2d5 8/8/8/3pk3/8/8/3R4/4K3 w - - 0 1",
+    "100 d2d5 8/8/8/3pk3/8/8/3R4/3RK3 w - - 0 1",
+    "400 e5d4 4k3/8/8/4p3/3R4/8/8/3RK3 b - - 0 1",
+    "0 e5d6 4k3/8/8/3pP3/8/8/8/4K3 w - d6 0 1",
+    "0 a7a8q 4k3/P7/8/8/8/8/8/4K3 w - - 0 1",
+    "0 e1g1 4k3/8/8/8/8/8/8/4K2R w K - 0 1",
+};
+
+// Expected result for the side with the pawn - fen, from both sides and on both halves of the board
+const std::vector<std::string> kpkCases =
+{
+    "1 4k3/8/4K3/4P3/8/8/8/8 w - - 0 1",
+    "1 4k3/8/4K3/4P3/8/8/8/8 b - - 0 1",
+    "0 4k3/4P3/4K3/8/8/8/8/8 b - - 0 1",
+    "1 4k3/4P3/4K3/8/8/8/8/8 w - - 0 1",
+    "0 8/8/8/8/8/8/3kP3/7K b - - 0 1",
+    "1 8/8/8/8/8/8/3kP3/7K w - - 0 1",
+    "0 k7/8/K7/P7/8/8/8/8 w - - 0 1",
+    "0 7k/8/7K/7P/8/8/8/8 w - - 0 1",
+    "1 6k1/8/6K1/6P1/8/8/8/8 w - - 0 1",
+    "0 4k3/8/8/8/8/8/7P/K7 b - - 0 1",
+    "1 8/8/8/8/4p3/4k3/8/4K3 w - - 0 1",
+    "0 8/8/8/8/8/4k3/4p3/4K3 w - - 0 1",
+};
+
+// The longest mates of the endings known from the literature, in plies
+const std::vector<std::pair<std::string, int>> longestMates =
+{
+    {"KQK", 19}, {"KRK", 31}, {"KBBK", 37}, {"KBNK", 65}, {"KQKR", 69},
+};
+
+// Expected entry - fen, mates in one and checkmates from both sides
+const std::vector<std::string> tablebaseCases =
+{
+    "1 k7/8/1K6/8/8/8/7Q/8 w - - 0 1",
+    "1 8/7q/8/8/8/1k6/8/K7 b - - 0 1",
+    "0 7k/6Q1/6K1/8/8/8/8/8 b - - 0 1",
+    "0 8/8/8/8/8/6k1/6q1/7K w - - 0 1",
+    "255 8/8/8/4k3/8/8/8/KB6 w - - 0 1",
+    "255 8/8/8/8/1p6/6k1/P7/K7 w - - 0 1",
+};
+
+// Name - clock - increment - moves per time control, 0 for sudden death, all in milliseconds
+const std::vector<std::tuple<std::string, int64_t, int64_t, int>> timeControls =
+{
+    { "3+0",     3000, 0,   0  },
+    { "10+0.1", 10000, 100, 0  },
+    { "60+0.6", 60000, 600, 0  },
+    { "40/60",  60000, 0,   40 },
+};
+
+// Polyglot key - fen, from the description of the book format
+const std::vector<std::pair<Key, std::string>> polyglotKeyCases =
+{
+    { 0x463B96181691FC9CULL, "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1" },
+    { 0x823C9B50FD114196ULL, "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1" },
+    { 0x0756B94461C50FB0ULL, "rnbqkbnr/ppp1pppp/8/3p4/4P3/8/PPPP1PPP/RNBQKBNR w KQkq d6 0 2" },
+    { 0x662FAFB965DB29D4ULL, "rnbqkbnr/ppp1pppp/8/3pP3/8/8/PPPP1PPP/RNBQKBNR b KQkq - 0 2" },
+    { 0x22A48B5A8E47FF78ULL, "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3" },
+    { 0x652A607CA3F242C1ULL, "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPPKPPP/RNBQ1BNR b kq - 0 3" },
+    { 0x00FDD303C946BDD9ULL, "rnbq1bnr/ppp1pkpp/8/3pPp2/8/8/PPPPKPPP/RNBQ1BNR w - - 0 4" },
+    { 0x3C8123EA7B067637ULL, "rnbqkbnr/p1pppppp/8/8/PpP4P/8/1P1PPPP1/RNBQKBNR b KQkq c3 0 3" },
+    { 0x5C3F9B829B279560ULL, "rnbqkbnr/p1pppppp/8/8/P6P/R1p5/1P1PPPP1/1NBQKBNR b Kkq - 0 4" },
+};
+
+// Fen - move in the book - weight - the move in the engine, empty if it is not legal
+const std::vector<std::tuple<std::string, std::string, int, std::string>> bookCases =
+{
+    { startPosFEN,                                                      "e2e4",  10, "e2e4"  },
+    { startPosFEN,                                                      "d2d4",  5,  "d2d4"  },
+    { startPosFEN,                                                      "e2e5",  5,  ""      },
+    { "r3k2r/8/8/8/8/8/8/R3K2R w KQkq - 0 1",                           "e1h1",  1,  "e1g1"  },
+    { "r3k2r/8/8/8/8/8/8/R3K2R w KQkq - 0 1",                           "e1a1",  1,  "e1c1"  },
+    { "r3k2r/8/8/8/8/8/8/R3K2R b KQkq - 0 1",                           "e8h8",  1,  "e8g8"  },
+    { "r3k2r/8/8/8/8/8/8/R3K2R b KQkq - 0 1",                           "e8a8",  1,  "e8c8"  },
+    { "8/P6k/8/8/8/8/8/K7 w - - 0 1",                                   "a7a8q", 3,  "a7a8q" },
+    { "8/P6k/8/8/8/8/8/K7 w - - 0 1",                                   "a7a8n", 1,  "a7a8n" },
+    { "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3",  "e5f6",  1,  "e5f6"  },
+};
+
+// The entry of the position from the entries after each of its moves, or NOT_FOUND if
+// one of them is not in the loaded tables. The positions after a double push that can be
+// captured en passant are not in the tables, they are scored from their own moves.
+uint8_t minimaxDTM(Position& pos)
+{
+    MoveList moveList;
+    PosInfo posInfo;
+    int winIn = Tablebases::MAX_DTM + 1, lossIn = -1;
+    bool draw = false;
+
+    MoveGen::generate(pos, moveList);
+
+    if (moveList.count == 0)
+        return pos.Checkers() ? 0 : Tablebases::DRAW;
+
+    for (int i = 0; i < moveList.count; i++)
+    {
+        pos.MakeMove(moveList.moves[i].move, posInfo);
+        uint8_t dtm = popCount(pos.Pieces()) == 2        ? Tablebases::DRAW
+                    : pos.EnpassantSquare() != NO_SQUARE ? minimaxDTM(pos)
+                                                         : Tablebases::probeDTM(pos);
+        pos.UndoMove(moveList.moves[i].move);
+
+        if (dtm == Tablebases::NOT_FOUND)
+            return Tablebases::NOT_FOUND;
+
+        if (dtm == Tablebases::DRAW)
+            draw = true;
+        else if (dtm & 1)
+            lossIn = std::max(lossIn, dtm + 1);
+        else
+            winIn = std::min(winIn, dtm + 1);
+    }
+
+    return winIn <= Tablebases::MAX_DTM ? uint8_t(winIn) : draw ? Tablebases::DRAW : uint8_t(lossIn);
+}
+
+// Sets up a random legal position of one of the loaded tables, with the colors flipped every other time
+void randomTablebasePosition(std::mt19937_64& rng, Position& pos, PosInfo& posInfo)
+{
+    while (true)
+    {
+        const Tablebases::Table& table = Tablebases::table(rng() % Tablebases::numTables());
+
+        if (!table.entries)
+            continue;
+
+        uint64_t idx = rng() % table.numEntries;
+        Square squares[Tablebases::MAX_PIECES];
+        Piece pieces[Tablebases::MAX_PIECES];
+        Color sideToMove;
+        Bitboard occupied = 0;
+
+        Tablebases::decode(table, idx, squares, sideToMove);
+
+        for (int i = 0; i < table.numPieces; i++)
+            occupied |= squares[i];
+
+        if (popCount(occupied) != table.numPieces || Tablebases::index(table, squares, sideToMove) != idx)
+            continue;
+
+        bool flip = rng() & 1;
+
+        for (int i = 0; i < table.numPieces; i++)
+        {
+            pieces[i]  = (flip ? getPiece(getType(table.pieces[i]), ~getColor(table.pieces[i])) : table.pieces[i]);
+            squares[i] = (flip ? relativeSquare(squares[i], BLACK) : squares[i]);
+        }
+
+        pos.Set(pieces, squares, table.numPieces, flip ? ~sideToMove : sideToMove, &posInfo);
+
+        if (!(pos.AttackersTo(pos.KingSquare(~pos.SideToMove())) & pos.Pieces(pos.SideToMove())))
+            return;
+    }
+}
+
+#if !defined(_WIN32)
+// The engine started as a child process in UCI mode, with its stdin and stdout connected to pipes
+class EngineProcess
+{
+public:
+    explicit EngineProcess(const std::string& engine)
+    {
+        int toEngine[2], fromEngine[2];
+
+        if (pipe(toEngine) || pipe(fromEngine))
+            return;
+
+        pid = fork();
+
+        if (pid == 0)
+        {
+            dup2(toEngine[0], STDIN_FILENO);
+            dup2(fromEngine[1], STDOUT_FILENO);
+            close(toEngine[1]);
+            close(fromEngine[0]);
+            execl(engine.c_str(), engine.c_str(), "uci", nullptr);
+            _exit(1);
+        }
+
+        close(toEngine[0]);
+        close(fromEngine[1]);
+        input  = fdopen(toEngine[1], "w");
+        output = fdopen(fromEngine[0], "r");
+    }
+
+    ~EngineProcess()
+    {
+        if (input)
+            fclose(input);
+
+        if (output)
+            fclose(output);
+
+        if (pid > 0)
+            waitpid(pid, nullptr, 0);
+    }
+
+    bool running() const { return pid > 0 && input && output; }
+
+    void send(const std::string& command)
+    {
+        fputs((command + "\n").c_str(), input);
+        fflush(input);
+    }
+
+    // Reads lines until one starts with the prefix and returns how many
+    // bestmoves were among them, including the last line
+    int readUntil(const std::string& prefix)
+    {
+        char line[4096];
+        int bestMoves = 0;
+
+        while (fgets(line, sizeof(line), output))
+        {
+            bestMoves += (std::strncmp(line, "bestmove", 8) == 0);
+
+            if (std::strncmp(line, prefix.c_str(), prefix.size()) == 0)
+                break;
+        }
+
+        return bestMoves;
+    }
+
+private:
+    pid_t pid = -1;
+    FILE* input = nullptr;
+    FILE* output = nullptr;
+};
+#endif
+
+// The Polyglot encoding of a move in long algebraic notation, e.g. e1h1 or a7a8q
+uint16_t bookMove(const std::string& moveString)
+{
+    int promotion = (moveString.size() > 4 ? int(std::string(" nbrq").find(moveString[4])) : 0);
+
+    return uint16_t((promotion << 12) | ((moveString[1] - '1') << 9) | ((moveString[0] - 'a') << 6)
+                                       | ((moveString[3] - '1') << 3) |  (moveString[2] - 'a'));
+}
+
+// Writes the entries as a Polyglot book, sorted by key
+void writeBook(const std::string& path, std::vector<std::array<uint64_t, 3>>& entries)
+{
+    std::sort(entries.begin(), entries.end());
+    std::ofstream file(path, std::ios::binary);
+
+    for (const auto& [key, move, weight] : entries)
+    {
+        unsigned char entry[Book::ENTRY_SIZE] = {};
+
+        for (int i = 0; i < 8; i++)
+            entry[i] = uint8_t(key >> (56 - 8 * i));
+
+        entry[8]  = uint8_t(move >> 8);
+        entry[9]  = uint8_t(move);
+        entry[10] = uint8_t(weight >> 8);
+        entry[11] = uint8_t(weight);
+
+        file.write(reinterpret_cast<const char*>(entry), sizeof(entry));
+    }
+}
+
+Move findMove(const Position& pos, const std::string& moveString)
+{
+    MoveList moveList;
+    MoveGen::generate(pos, moveList);
+
+    for (int i = 0; i < moveList.count; i++)
+        if (UCI::moveToString(moveList.moves[i].move) == moveString)
+            return moveList.moves[i].move;
+
+    return MOVE_NONE;
+}
+
+enum EvalMode { EVAL_INCREMENTAL, EVAL_REFRESH, EVAL_VERIFY };
+
+// Evaluates every node of the tree like a search does, either with the incrementally
+// updated accumulators or from scratch. Verifying compares both at every node.
+uint64_t evalWalk(Position& pos, int depth, EvalMode mode, int64_t& checksum, uint64_t& mismatches)
+{
+    int eval = (mode == EVAL_REFRESH ? NNUE::evaluateRefresh(pos) : NNUE::evaluate(pos));
+
+    if (mode == EVAL_VERIFY && eval != NNUE::evaluateRefresh(pos))
+        mismatches++;
+
+    checksum += eval;
+
+    if (depth == 0)
+        return 1;
+
+    MoveList moveList;
+    PosInfo posInfo;
+    uint64_t nodes = 1;
+
+    MoveGen::generate(pos, moveList);
+
+    for (int i = 0; i < moveList.count; i++)
+    {
+        pos.MakeMove(moveList.moves[i].move, posInfo);
+        nodes += evalWalk(pos, depth - 1, mode, checksum, mismatches);
+        pos.UndoMove(moveList.moves[i].move);
+    }
+
+    return nodes;
+}
+
+enum LeafMode { LEAF_GENERATE, LEAF_COUNT, LEAF_VERIFY };
+
+// Whether the captures and the quiet moves together are all the legal moves without any
+// move in both, and each move is in the stage the move picker expects it in
+bool stagesMatch(const Position& pos)
+{
+    MoveList all, captures, quiets;
+
+    MoveGen::generate(pos, all);
+    MoveGen::generate(pos, captures, CAPTURES);
+    MoveGen::generate(pos, quiets, QUIETS);
+
+    std::vector<Move> allMoves, stageMoves;
+
+    for (int i = 0; i < all.count; i++)
+        allMoves.push_back(all.moves[i].move);
+
+    for (int i = 0; i < captures.count; i++)
+    {
+        if (isQuiet(pos, captures.moves[i].move))
+            return false;
+
+        stageMoves.push_back(captures.moves[i].move);
+    }
+
+    for (int i = 0; i < quiets.count; i++)
+    {
+        if (!isQuiet(pos, quiets.moves[i].move))
+            return false;
+
+        stageMoves.push_back(quiets.moves[i].move);
+    }
+
+    // A move in both stages shows up twice in the sorted list, so it can not match the full list
+    std::sort(allMoves.begin(), allMoves.end());
+    std::sort(stageMoves.begin(), stageMoves.end());
+
+    return allMoves == stageMoves;
+}
+
+// Walks the tree like perft without the cache and sizes the last ply either by generating
+// the move list or by counting the moves. Verifying compares both at every leaf and checks
+// the capture and quiet stages against all the moves at every node above the leaves.
+uint64_t leafWalk(Position& pos, int depth, LeafMode mode, uint64_t& mismatches)
+{
+    if (mode == LEAF_VERIFY && !stagesMatch(pos))
+        mismatches++;
+
+    if (depth == 1)
+    {
+        if (mode == LEAF_COUNT)
+            return MoveGen::count(pos);
+
+        MoveList moveList;
+        MoveGen::generate(pos, moveList);
+
+        if (mode == LEAF_VERIFY && MoveGen::count(pos) != moveList.count)
+            mismatches++;
+
+        return moveList.count;
+    }
+
+    MoveList moveList;
+    PosInfo posInfo;
+    uint64_t nodes = 0;
+
+    MoveGen::generate(pos, moveList);
+
+    for (int i = 0; i < moveList.count; i++)
+    {
+        pos.MakeMove(moveList.moves[i].move, posInfo);
+        nodes += leafWalk(pos, depth - 1, mode, mismatches);
+        pos.UndoMove(moveList.moves[i].move);
+    }
+
+    return nodes;
+}
+
+// Slider attacks found by stepping along the rays, the reference for the table lookups
+Bitboard walkAttacks(PieceType pt, Square square, Bitboard blockers)
+{
+    Bitboard attacks = 0;
+
+    for (Direction dir : (pt == BISHOP ? std::vector<Direction>{NORTH_EAST, NORTH_WEST, SOUTH_EAST, SOUTH_WEST}
+                                       : std::vector<Direction>{NORTH, EAST, SOUTH, WEST}))
+    {
+        Bitboard bitboard = getSquareMask(square);
+
+        while ((bitboard = shift(bitboard, dir)))
+        {
+            attacks |= bitboard;
+
+            if (bitboard & blockers)
+                break;
+        }
+    }
+
+    return attacks;
+}
+
+// Searches the positions to the given depth and reports the nodes, the reached selective
+// depth, the nodes per second and the hit rates of the evaluation hash tables
+void runSearchBench(const std::vector<std::string>& fens, int depth)
+{
+    Position pos;
+    PosInfo posInfo;
+    Search::Limits limits;
+    uint64_t totalNodes = 0, pickerNodes = 0, capturesSkipped = 0, quietsSkipped = 0, qsearchNodes = 0, tbHits = 0;
+    uint64_t pawnProbes = 0, pawnHits = 0, materialProbes = 0, materialHits = 0;
+    int64_t totalTime = 0;
+
+    limits.depth = depth;
+
+    for (const auto& fen : fens)
+    {
+        pos.Set(fen, &posInfo);
+        TT.Clear();
+
+        Move bestMove = Search::go(pos, limits, false);
+        const Search::Info& info = Search::info();
 
+        totalNodes      += info.nodes;
+        totalTime       += info.time;
+        pickerNodes     += info.pickerNodes;
+        capturesSkipped += info.capturesSkipped;
+        quietsSkipped   += info.quietsSkipped;
+        qsearchNodes    += info.qsearchNodes;
+        tbHits          += info.tbHits;
+        pawnProbes      += info.pawnProbes;
+        pawnHits        += info.pawnHits;
+        materialProbes  += info.materialProbes;
+        materialHits    += info.materialHits;
+
+        std::cout << "Depth " << info.depth << "  Seldepth: " << info.seldepth << "  Nodes: " << info.nodes
+                  << "  Time: " << info.time << " ms  Nodes/s: " << info.nps
+                  << "  Score: " << info.score << "  Best move: " << UCI::moveToString(bestMove) << std::endl;
+    }
+
+    std::cout << "\nNodes: "  << totalNodes << "\n";
+    std::cout << "Time: "      << totalTime << " ms\n";
+    std::cout << "Nodes/s: "   << totalNodes * 1000 / std::max<int64_t>(totalTime, 1) << "\n";
+    std::cout << "Quiescence nodes: "    << 100.0 * qsearchNodes / std::max<uint64_t>(totalNodes, 1) << "%\n";
+    std::cout << "Tablebase hits: "      << tbHits << "\n";
+    std::cout << "Pawn table hits: "     << 100.0 * pawnHits / std::max<uint64_t>(pawnProbes, 1) << "% of " << pawnProbes << " probes\n";
+    std::cout << "Material table hits: " << 100.0 * materialHits / std::max<uint64_t>(materialProbes, 1) << "% of " << materialProbes << " probes\n";
+
+    // How often a cutoff made it unnecessary to generate a stage of the move picker
+    std::cout << "Captures generation skipped: " << 100.0 * capturesSkipped / std::max<uint64_t>(pickerNodes, 1) << "%\n";
+    std::cout << "Quiets generation skipped: "   << 100.0 * quietsSkipped   / std::max<uint64_t>(pickerNodes, 1) << "%" << std::endl;
+}
+
+} // anonymous namespace
+
+void perft()
+{
     Position pos;
     PosInfo posInfo;
     int depth;
     uint64_t expectedNodes;
     std::string fen;
-    char token;
 
-    for (const auto& testCase : testCases)
-    {
-        std::istringstream ss(testCase);
+    // Every node is generated, a bug in the cache could hide a bug in the move generator.
+    // perftcache compares the cached counts against these.
+    Perft::setCacheSize(0);
 
-        ss >> depth >> expectedNodes;
-        ss >> std::noskipws >> token;
-        ss >> std::skipws;
-        std::getline(ss, fen);
+    for (const auto& testCase : perftCases)
+    {
+        parseCase(testCase, depth, expectedNodes, fen);
 
         pos.Set(fen, &posInfo);
 
@@ -87,6 +648,1066 @@ void perft()
     }
 }
 
+// Runs every perft case with and without the perft cache and reports the
+// cache hit rate and the time saved against the uncached run
+void perftCache()
+{
+    Position pos;
+    PosInfo posInfo;
+    int depth;
+    uint64_t expectedNodes;
+    std::string fen;
+    int64_t totalUncached = 0, totalCached = 0;
+
+    for (const auto& testCase : perftCases)
+    {
+        parseCase(testCase, depth, expectedNodes, fen);
+        pos.Set(fen, &posInfo);
+
+        Perft::setCacheSize(0);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        uint64_t uncachedNodes = Perft::getNodes(pos, depth);
+        auto stop = std::chrono::high_resolution_clock::now();
+        auto uncached = std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count();
+
+        Perft::setCacheSize(perftCacheSize);
+
+        start = std::chrono::high_resolution_clock::now();
+        uint64_t cachedNodes = Perft::getNodes(pos, depth);
+        stop = std::chrono::high_resolution_clock::now();
+        auto cached = std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count();
+
+        Perft::CacheStats stats = Perft::cacheStats();
+        double hitRate = stats.probes ? 100.0 * stats.hits / stats.probes : 0.0;
+
+        totalUncached += uncached;
+        totalCached   += cached;
+
+        std::cout << "Depth " << depth << "  Nodes: " << cachedNodes
+                  << "  Uncached: " << uncached << " ms  Cached: " << cached << " ms"
+                  << "  Saved: " << uncached - cached << " ms  Hit rate: " << hitRate << "% - ";
+
+        if (cachedNodes == expectedNodes && uncachedNodes == expectedNodes)
+            std::cout << GREEN_TEXT << "PASSED" << RESET_TEXT << std::endl;
+
+        else
+            std::cout << RED_TEXT   << "FAILED" << RESET_TEXT << " (expected: " << expectedNodes << ")" << std::endl;
+    }
+
+    std::cout << "\nTotal  Uncached: " << totalUncached << " ms  Cached: " << totalCached
+              << " ms  Saved: " << totalUncached - totalCached << " ms" << std::endl;
+}
+
+// Runs every perft case on one thread and on the given number of threads
+// and reports the speedup. The node counts must match exactly.
+void perftThreads(int numThreads)
+{
+    Position pos;
+    PosInfo posInfo;
+    int depth;
+    uint64_t expectedNodes;
+    std::string fen;
+    int64_t totalSingle = 0, totalParallel = 0;
+
+    // Cache hits depend on the order the threads visit the tree, so compare the raw tree walks
+    Perft::setCacheSize(0);
+
+    for (const auto& testCase : perftCases)
+    {
+        parseCase(testCase, depth, expectedNodes, fen);
+        pos.Set(fen, &posInfo);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        uint64_t singleNodes = Perft::getNodes(pos, depth);
+        auto stop = std::chrono::high_resolution_clock::now();
+        auto single = std::chrono::duration_cast<std::chrono::microseconds>(stop - start).count();
+
+        start = std::chrono::high_resolution_clock::now();
+        uint64_t parallelNodes = Perft::getNodes(pos, depth, numThreads);
+        stop = std::chrono::high_resolution_clock::now();
+        auto parallel = std::chrono::duration_cast<std::chrono::microseconds>(stop - start).count();
+
+        totalSingle   += single;
+        totalParallel += parallel;
+
+        std::cout << "Depth " << depth << "  Nodes: " << parallelNodes
+                  << "  1 thread: " << single / 1000 << " ms  " << numThreads << " threads: " << parallel / 1000
+                  << " ms  Speedup: " << double(single) / std::max<int64_t>(parallel, 1) << " - ";
+
+        if (singleNodes == expectedNodes && parallelNodes == expectedNodes)
+            std::cout << GREEN_TEXT << "PASSED" << RESET_TEXT << std::endl;
+
+        else
+            std::cout << RED_TEXT   << "FAILED" << RESET_TEXT << " (expected: " << expectedNodes << ")" << std::endl;
+    }
+
+    std::cout << "\nTotal  1 thread: " << totalSingle / 1000 << " ms  " << numThreads << " threads: "
+              << totalParallel / 1000 << " ms  Speedup: " << double(totalSingle) / std::max<int64_t>(totalParallel, 1) << std::endl;
+}
+
+// Searches a fixed set of positions to the given depth and reports the nodes,
+// the reached selective depth and the nodes per second of the search
+void searchBench(int depth)
+{
+    runSearchBench(searchCases, depth);
+}
+
+// Searches long endgames, where the material table and the specialized
+// evaluation functions of the known endings are used the most
+void endgameBench(int depth)
+{
+    runSearchBench(endgameCases, depth);
+}
+
+// Searches the search positions to the given depth with 1, 2, 4, 8 and 16 threads and
+// reports the time to depth and the nodes per second relative to a single thread
+void smpBench(int depth)
+{
+    Position pos;
+    PosInfo posInfo;
+    Search::Limits limits;
+    int64_t singleTime = 0;
+    uint64_t singleNps = 0;
+
+    limits.depth = depth;
+
+    for (int numThreads : {1, 2, 4, 8, 16})
+    {
+        Threads.Set(numThreads);
+
+        uint64_t totalNodes = 0;
+        int64_t totalTime = 0;
+
+        for (const auto& fen : searchCases)
+        {
+            pos.Set(fen, &posInfo);
+            TT.Clear();
+
+            Search::go(pos, limits, false);
+
+            totalNodes += Search::info().nodes;
+            totalTime  += Search::info().time;
+        }
+
+        uint64_t nps = totalNodes * 1000 / std::max<int64_t>(totalTime, 1);
+
+        if (numThreads == 1)
+        {
+            singleTime = std::max<int64_t>(totalTime, 1);
+            singleNps  = std::max<uint64_t>(nps, 1);
+        }
+
+        std::cout << "Threads: " << numThreads << "  Time to depth " << depth << ": " << totalTime << " ms"
+                  << "  Nodes/s: " << nps
+                  << "  Time to depth speedup: " << double(singleTime) / std::max<int64_t>(totalTime, 1)
+                  << "  Nodes/s scaling: " << double(nps) / singleNps << std::endl;
+    }
+
+    Threads.Set(1);
+}
+
+// Runs the whole perft suite and reports the node throughput, used to
+// measure how changes to the make/undo and move generation paths cost per node
+void bench()
+{
+    Position pos;
+    PosInfo posInfo;
+    int depth;
+    uint64_t expectedNodes, totalNodes = 0;
+    std::string fen;
+
+    // Measure the raw speed of the tree walk
+    Perft::setCacheSize(0);
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    for (const auto& testCase : perftCases)
+    {
+        parseCase(testCase, depth, expectedNodes, fen);
+        pos.Set(fen, &posInfo);
+        totalNodes += Perft::getNodes(pos, depth);
+    }
+
+    auto stop = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(stop - start);
+    uint64_t micros = std::max<uint64_t>(duration.count(), 1);
+
+    std::cout << "Nodes: "    << totalNodes << "\n";
+    std::cout << "Time: "     << micros / 1000 << " ms\n";
+    std::cout << "Nodes/s: "  << totalNodes * 1000000 / micros << "\n";
+    std::cout << "ns/node: "  << double(micros) * 1000 / totalNodes << std::endl;
+}
+
+// Compares generating the move list at the last ply of perft against only counting
+// the moves, over the whole perft suite, after checking that both agree at every leaf
+// and that the capture and quiet stages split the moves of every node between them
+void moveCount()
+{
+    Position pos;
+    PosInfo posInfo;
+    int depth;
+    uint64_t expectedNodes, mismatches = 0;
+    int64_t generateTime = 0, countTime = 0;
+    std::string fen;
+
+    for (const auto& testCase : perftCases)
+    {
+        parseCase(testCase, depth, expectedNodes, fen);
+        pos.Set(fen, &posInfo);
+
+        // The deepest cases take too long to verify leaf by leaf
+        if (depth <= 5)
+            leafWalk(pos, depth, LEAF_VERIFY, mismatches);
+
+        uint64_t nodes[2];
+        int64_t micros[2];
+
+        for (LeafMode mode : {LEAF_GENERATE, LEAF_COUNT})
+        {
+            auto start = std::chrono::high_resolution_clock::now();
+
+            nodes[mode] = leafWalk(pos, depth, mode, mismatches);
+
+            auto stop = std::chrono::high_resolution_clock::now();
+            micros[mode] = std::chrono::duration_cast<std::chrono::microseconds>(stop - start).count();
+        }
+
+        generateTime += micros[LEAF_GENERATE];
+        countTime    += micros[LEAF_COUNT];
+
+        std::cout << "Depth " << depth << "  Nodes: " << nodes[LEAF_COUNT]
+                  << "  Generate: " << micros[LEAF_GENERATE] / 1000 << " ms"
+                  << "  Count: "    << micros[LEAF_COUNT]    / 1000 << " ms - ";
+
+        if (nodes[LEAF_GENERATE] == expectedNodes && nodes[LEAF_COUNT] == expectedNodes)
+            std::cout << GREEN_TEXT << "PASSED" << RESET_TEXT << std::endl;
+
+        else
+            std::cout << RED_TEXT   << "FAILED" << RESET_TEXT << " (expected: " << expectedNodes << ")" << std::endl;
+    }
+
+    std::cout << "\nLeaf and stage mismatches: " << mismatches << "\n";
+    std::cout << "Generate: " << generateTime / 1000 << " ms\n";
+    std::cout << "Count: "    << countTime    / 1000 << " ms\n";
+    std::cout << "Speedup: "  << double(generateTime) / std::max<int64_t>(countTime, 1) << std::endl;
+}
+
+// Checks the slider attacks of every square against a ray walk for all sets of relevant blockers,
+// with random pieces added outside of them, and measures the AttackersTo throughput on the perft
+// positions. The checksum covers every lookup, so it has to match between the magic and PEXT builds.
+void sliders()
+{
+#if defined(USE_PEXT)
+    std::cout << "Slider backend: PEXT\n";
+#else
+    std::cout << "Slider backend: Magic\n";
+#endif
+
+    uint64_t lookups = 0, mismatches = 0, checksum = 0, random = 0x9E3779B97F4A7C15ULL;
+
+    for (PieceType pt : {BISHOP, ROOK})
+    {
+        for (Square square = A1; square < NUM_SQUARES; square++)
+        {
+            Bitboard mask = (pt == BISHOP ? bishopMagics : rookMagics)[square].mask;
+            Bitboard blockers = 0;
+
+            do
+            {
+                random ^= random << 13;
+                random ^= random >> 7;
+                random ^= random << 17;
+
+                Bitboard occupancy = blockers | (random & ~mask);
+                Bitboard attacks   = attackMask(pt, square, occupancy);
+
+                mismatches += (attacks != walkAttacks(pt, square, occupancy));
+                checksum    = (checksum ^ attacks) * 0x100000001B3ULL;
+                lookups++;
+
+                blockers = (blockers - mask) & mask;
+            } while (blockers);
+        }
+    }
+
+    std::cout << "Lookups: " << lookups << "  Checksum: " << std::hex << checksum << std::dec << " - ";
+
+    if (mismatches == 0)
+        std::cout << GREEN_TEXT << "PASSED" << RESET_TEXT << std::endl;
+
+    else
+        std::cout << RED_TEXT   << "FAILED" << RESET_TEXT << " (" << mismatches << " mismatches)" << std::endl;
+
+    Position pos;
+    PosInfo posInfo;
+    int depth;
+    uint64_t expectedNodes, calls = 0;
+    Bitboard sink = 0;
+    std::string fen;
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    for (const auto& testCase : perftCases)
+    {
+        parseCase(testCase, depth, expectedNodes, fen);
+        pos.Set(fen, &posInfo);
+
+        for (int i = 0; i < 20000; i++)
+        {
+            // Vary the occupancy so the lookups cannot be hoisted out of the loop
+            Bitboard occupancy = pos.Pieces() ^ (i & 0xFF);
+
+            for (Square square = A1; square < NUM_SQUARES; square++)
+                sink ^= pos.AttackersTo(square, occupancy);
+        }
+
+        calls += 20000 * NUM_SQUARES;
+    }
+
+    auto stop = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(stop - start);
+    uint64_t micros = std::max<uint64_t>(duration.count(), 1);
+
+    std::cout << "AttackersTo calls: " << calls << "  Time: " << micros / 1000 << " ms"
+              << "  Calls/s: " << calls * 1000000 / micros << "  ns/call: " << double(micros) * 1000 / calls
+              << "  (" << (sink & 1) << ")" << std::endl;
+}
+
+// Measures the make/undo throughput by making and undoing every legal move
+// of the perft positions many times, without generating moves in between
+void makeMove()
+{
+    Position pos;
+    PosInfo posInfo, newPosInfo;
+    int depth;
+    uint64_t expectedNodes, pairs = 0;
+    std::string fen;
+    MoveList moveList;
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    for (const auto& testCase : perftCases)
+    {
+        parseCase(testCase, depth, expectedNodes, fen);
+        pos.Set(fen, &posInfo);
+
+        moveList.count = 0;
+        MoveGen::generate(pos, moveList);
+
+        for (int i = 0; i < 20000; i++)
+        {
+            for (int j = 0; j < moveList.count; j++)
+            {
+                pos.MakeMove(moveList.moves[j].move, newPosInfo);
+                pos.UndoMove(moveList.moves[j].move);
+            }
+        }
+
+        pairs += 20000 * uint64_t(moveList.count);
+    }
+
+    auto stop = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(stop - start);
+    uint64_t micros = std::max<uint64_t>(duration.count(), 1);
+
+    std::cout << "Make/undo pairs: " << pairs << "  Time: " << micros / 1000 << " ms"
+              << "  Pairs/s: " << pairs * 1000000 / micros << "  ns/pair: " << double(micros) * 1000 / pairs << std::endl;
+}
+
+// Compares the evaluation speed of the incrementally updated accumulators against refreshing
+// them at every node, on a random network as no trained one comes with the engine
+void nnueBench()
+{
+    const std::string path = "nnuebench.nnue";
+
+    if (!writeRandomNetwork(path) || !NNUE::load(path))
+    {
+        std::cout << RED_TEXT << "FAILED" << RESET_TEXT << " to write and load " << path << std::endl;
+        return;
+    }
+
+    std::remove(path.c_str());
+    std::cout << "Kernels: " << NNUE::simdName() << "\n";
+
+    Position pos;
+    PosInfo posInfo;
+    uint64_t mismatches = 0;
+    int64_t checksums[3] = {};
+
+    for (EvalMode mode : { EVAL_VERIFY, EVAL_INCREMENTAL, EVAL_REFRESH })
+    {
+        uint64_t nodes = 0;
+
+        auto start = std::chrono::high_resolution_clock::now();
+
+        for (const auto& fen : searchCases)
+        {
+            pos.Set(fen, &posInfo);
+            nodes += evalWalk(pos, 3, mode, checksums[mode], mismatches);
+        }
+
+        auto stop = std::chrono::high_resolution_clock::now();
+        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(stop - start);
+        uint64_t micros = std::max<uint64_t>(duration.count(), 1);
+
+        if (mode == EVAL_VERIFY)
+            continue;
+
+        std::cout << (mode == EVAL_INCREMENTAL ? "Incremental" : "Refresh    ") << "  Evals: " << nodes
+                  << "  Time: " << micros / 1000 << " ms  Evals/s: " << nodes * 1000000 / micros
+                  << "  ns/eval: " << double(micros) * 1000 / nodes << "\n";
+    }
+
+    bool passed = !mismatches && checksums[EVAL_INCREMENTAL] == checksums[EVAL_REFRESH];
+
+    std::cout << (passed ? GREEN_TEXT "PASSED" : RED_TEXT "FAILED") << RESET_TEXT
+              << " mismatches: " << mismatches << "  checksum: " << checksums[EVAL_REFRESH] << std::endl;
+}
+
+// Checks the static exchange evaluation on known exchanges, and that the threshold
+// form agrees with the full swap list for every capture of the test positions
+// over a range of thresholds. Then measures the calls per second of both forms.
+void see()
+{
+    Position pos;
+    PosInfo posInfo;
+    bool passed = true;
+
+    for (const auto& testCase : seeCases)
+    {
+        std::istringstream ss(testCase);
+        int expected;
+        std::string moveString, fen;
+
+        ss >> expected >> moveString >> std::ws;
+        std::getline(ss, fen);
+        pos.Set(fen, &posInfo);
+
+        Move move = findMove(pos, moveString);
+        int value = (move != MOVE_NONE ? pos.SEE(move) : VALUE_NONE);
+        bool ok   = (value == expected && pos.SEE_GE(move, expected) && !pos.SEE_GE(move, expected + 1));
+
+        passed &= ok;
+        std::cout << moveString << "  SEE: " << value << "  Expected: " << expected << " - "
+                  << (ok ? GREEN_TEXT "PASSED" : RED_TEXT "FAILED") << RESET_TEXT << std::endl;
+    }
+
+    std::vector<std::string> fens = searchCases;
+    std::vector<std::pair<std::string, std::vector<Move>>> captures;
+    uint64_t comparisons = 0, mismatches = 0;
+    int depth;
+    uint64_t expectedNodes;
+    std::string fen;
+
+    for (const auto& testCase : perftCases)
+    {
+        parseCase(testCase, depth, expectedNodes, fen);
+        fens.push_back(fen);
+    }
+
+    for (const auto& f : fens)
+    {
+        MoveList moveList;
+        pos.Set(f, &posInfo);
+        MoveGen::generate(pos, moveList);
+        captures.push_back({f, {}});
+
+        for (int i = 0; i < moveList.count; i++)
+        {
+            Move move = moveList.moves[i].move;
+
+            if (!pos.IsCapture(move))
+                continue;
+
+            captures.back().second.push_back(move);
+            int value = pos.SEE(move);
+
+            for (int threshold = -1000; threshold <= 1000; threshold += 10)
+            {
+                comparisons++;
+                mismatches += (pos.SEE_GE(move, threshold) != (value >= threshold));
+            }
+        }
+    }
+
+    passed &= !mismatches;
+    std::cout << "SEE_GE against SEE: " << comparisons << " comparisons, " << mismatches << " mismatches - "
+              << (mismatches ? RED_TEXT "FAILED" : GREEN_TEXT "PASSED") << RESET_TEXT << "\n" << std::endl;
+
+    for (bool threshold : { false, true })
+    {
+        uint64_t calls = 0;
+        int64_t sink = 0;
+
+        auto start = std::chrono::high_resolution_clock::now();
+
+        for (const auto& [f, moves] : captures)
+        {
+            pos.Set(f, &posInfo);
+
+            for (int i = 0; i < 20000; i++)
+                for (Move move : moves)
+                    sink += (threshold ? pos.SEE_GE(move) : pos.SEE(move));
+
+            calls += 20000 * moves.size();
+        }
+
+        auto stop = std::chrono::high_resolution_clock::now();
+        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(stop - start);
+        uint64_t micros = std::max<uint64_t>(duration.count(), 1);
+
+        std::cout << (threshold ? "SEE_GE" : "SEE   ") << "  Calls: " << calls << "  Time: " << micros / 1000 << " ms"
+                  << "  Calls/s: " << calls * 1000000 / micros << "  ns/call: " << double(micros) * 1000 / calls
+                  << "  (" << (sink & 1) << ")" << std::endl;
+    }
+
+    std::cout << (passed ? GREEN_TEXT "PASSED" : RED_TEXT "FAILED") << RESET_TEXT << std::endl;
+}
+
+// Measures the time to solve the KPK bitbase and checks it on known wins and draws
+void kpk()
+{
+    constexpr int runs = 10;
+    int64_t minMicros = INT64_MAX;
+
+    for (int i = 0; i < runs; i++)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        Bitbases::init();
+        auto stop = std::chrono::high_resolution_clock::now();
+
+        minMicros = std::min<int64_t>(minMicros, std::chrono::duration_cast<std::chrono::microseconds>(stop - start).count());
+    }
+
+    std::cout << "Init: " << minMicros / 1000.0 << " ms  Size: " << Bitbases::KPK_SIZE / 8 << " bytes\n";
+
+    Position pos;
+    PosInfo posInfo;
+    bool passed = true;
+
+    for (const auto& testCase : kpkCases)
+    {
+        bool expectedWin = (testCase[0] == '1');
+        std::string fen = testCase.substr(2);
+
+        pos.Set(fen, &posInfo);
+
+        Color strongSide = (pos.Pieces(PAWN, WHITE) ? WHITE : BLACK);
+        bool win = (Endgames::KPK(pos, strongSide) != VALUE_DRAW);
+        bool ok  = (win == expectedWin);
+
+        passed &= ok;
+        std::cout << fen << "  " << (win ? "Win " : "Draw") << " - "
+                  << (ok ? GREEN_TEXT "PASSED" : RED_TEXT "FAILED") << RESET_TEXT << std::endl;
+    }
+
+    std::cout << (passed ? GREEN_TEXT "PASSED" : RED_TEXT "FAILED") << RESET_TEXT << std::endl;
+}
+
+// Checks the tables on known longest mates and positions, and that the entries of random positions
+// agree with the entries after their moves. Then measures the latency of probing random positions.
+void tablebases(const std::string& directory)
+{
+    int loaded = Tablebases::init(directory);
+    bool passed = (loaded == Tablebases::numTables());
+
+    std::cout << "Tables: " << loaded << " of " << Tablebases::numTables() << " loaded from " << directory << "\n";
+
+    for (const auto& [name, plies] : longestMates)
+    {
+        for (int i = 0; i < Tablebases::numTables(); i++)
+        {
+            const Tablebases::Table& table = Tablebases::table(i);
+
+            if (name != table.name || !table.entries)
+                continue;
+
+            int maxDtm = int(static_cast<const Tablebases::FileHeader*>(table.mapping)->maxDtm);
+            bool ok = (maxDtm == plies);
+
+            passed &= ok;
+            std::cout << name << "  Longest mate: " << maxDtm << "  Expected: " << plies << " - "
+                      << (ok ? GREEN_TEXT "PASSED" : RED_TEXT "FAILED") << RESET_TEXT << "\n";
+        }
+    }
+
+    Position pos;
+    PosInfo posInfo;
+
+    for (const auto& testCase : tablebaseCases)
+    {
+        std::istringstream ss(testCase);
+        int expected;
+        std::string fen;
+
+        ss >> expected >> std::ws;
+        std::getline(ss, fen);
+        pos.Set(fen, &posInfo);
+
+        int dtm = Tablebases::probeDTM(pos);
+        bool ok = (dtm == expected);
+
+        passed &= ok;
+        std::cout << fen << "  Entry: " << dtm << "  Expected: " << expected << " - "
+                  << (ok ? GREEN_TEXT "PASSED" : RED_TEXT "FAILED") << RESET_TEXT << "\n";
+    }
+
+    if (!loaded)
+        return;
+
+    constexpr int consistencyChecks = 200000;
+    std::mt19937_64 rng(1070372);
+    int checked = 0, mismatches = 0;
+
+    for (int i = 0; i < consistencyChecks; i++)
+    {
+        randomTablebasePosition(rng, pos, posInfo);
+
+        uint8_t expected = minimaxDTM(pos);
+
+        if (expected == Tablebases::NOT_FOUND)
+            continue;
+
+        checked++;
+
+        if (Tablebases::probeDTM(pos) != expected && mismatches++ < 10)
+            std::cout << RED_TEXT "Mismatch" RESET_TEXT << " " << pos.FEN() << "  Entry: " << int(Tablebases::probeDTM(pos))
+                      << "  From the moves: " << int(expected) << "\n";
+    }
+
+    passed &= !mismatches;
+    std::cout << "Consistent with the moves: " << checked - mismatches << " of " << checked << " random positions\n";
+
+    // Random positions hardly ever have a double push that can be captured en passant,
+    // so every such entry of the tables with pawns of both colors is checked
+    checked = mismatches = 0;
+
+    for (int t = 0; t < Tablebases::numTables(); t++)
+    {
+        const Tablebases::Table& table = Tablebases::table(t);
+        int pawns[NUM_COLORS] = {};
+
+        for (int i = 0; i < table.numPieces; i++)
+            pawns[getColor(table.pieces[i])] += (getType(table.pieces[i]) == PAWN);
+
+        if (!table.entries || !pawns[WHITE] || !pawns[BLACK])
+            continue;
+
+        for (uint64_t idx = 0; idx < table.numEntries; idx++)
+        {
+            Square squares[Tablebases::MAX_PIECES];
+            Color sideToMove;
+            Bitboard occupied = 0;
+
+            Tablebases::decode(table, idx, squares, sideToMove);
+
+            for (int i = 0; i < table.numPieces; i++)
+                occupied |= squares[i];
+
+            if (popCount(occupied) != table.numPieces || Tablebases::index(table, squares, sideToMove) != idx)
+                continue;
+
+            pos.Set(table.pieces, squares, table.numPieces, sideToMove, &posInfo);
+
+            if (pos.SquareIsAttacked(pos.KingSquare(~sideToMove), sideToMove))
+                continue;
+
+            MoveList moveList;
+            PosInfo nextInfo;
+            bool enpassant = false;
+
+            MoveGen::generate(pos, moveList);
+
+            for (int i = 0; i < moveList.count && !enpassant; i++)
+            {
+                pos.MakeMove(moveList.moves[i].move, nextInfo);
+                enpassant = (pos.EnpassantSquare() != NO_SQUARE);
+                pos.UndoMove(moveList.moves[i].move);
+            }
+
+            uint8_t expected = (enpassant ? minimaxDTM(pos) : Tablebases::NOT_FOUND);
+
+            if (expected == Tablebases::NOT_FOUND)
+                continue;
+
+            checked++;
+
+            if (Tablebases::probeDTM(pos) != expected && mismatches++ < 10)
+                std::cout << RED_TEXT "Mismatch" RESET_TEXT << " " << pos.FEN() << "  Entry: " << int(Tablebases::probeDTM(pos))
+                          << "  From the moves: " << int(expected) << "\n";
+        }
+    }
+
+    passed &= !mismatches;
+    std::cout << "Consistent after en passant: " << checked - mismatches << " of " << checked << " double pushes\n";
+
+    // Spread over enough positions that most of the probes miss the caches
+    constexpr int numPositions = 65536;
+    constexpr int rounds = 16;
+
+    std::vector<Position> positions(numPositions);
+    std::vector<PosInfo> posInfos(numPositions);
+    uint64_t checksum = 0;
+
+    for (int i = 0; i < numPositions; i++)
+        randomTablebasePosition(rng, positions[i], posInfos[i]);
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    for (int round = 0; round < rounds; round++)
+        for (int i = 0; i < numPositions; i++)
+            checksum += Tablebases::probeDTM(positions[i]);
+
+    auto stop = std::chrono::high_resolution_clock::now();
+    double nanos = double(std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count());
+
+    std::cout << "Probes: " << numPositions * rounds << "  ns/probe: " << nanos / (numPositions * rounds)
+              << "  checksum: " << checksum << "\n";
+
+    std::cout << (passed ? GREEN_TEXT "PASSED" : RED_TEXT "FAILED") << RESET_TEXT << std::endl;
+}
+
+// Checks the Polyglot keys and the decoding of castling, promotions and en passant on a book written
+// to the file, which is padded with random entries. Then measures the latency of probing random positions.
+void book(const std::string& path)
+{
+    Position pos;
+    PosInfo posInfo;
+    bool passed = true;
+
+    for (const auto& [expected, fen] : polyglotKeyCases)
+    {
+        Key key = Book::polyglotKey(pos.Set(fen, &posInfo));
+        bool ok = (key == expected);
+
+        passed &= ok;
+        std::cout << fen << "  Key: " << std::hex << key << std::dec << " - "
+                  << (ok ? GREEN_TEXT "PASSED" : RED_TEXT "FAILED") << RESET_TEXT << std::endl;
+    }
+
+    constexpr int numPadding = 1 << 22;
+    std::mt19937_64 rng(1070372);
+    std::vector<std::array<uint64_t, 3>> entries;
+
+    for (const auto& [fen, move, weight, expected] : bookCases)
+        entries.push_back({ Book::polyglotKey(pos.Set(fen, &posInfo)), bookMove(move), uint64_t(weight) });
+
+    for (int i = 0; i < numPadding; i++)
+        entries.push_back({ rng(), bookMove("a2a3"), 1 });
+
+    writeBook(path, entries);
+
+    if (!Book::open(path))
+    {
+        std::cout << RED_TEXT "Could not open " << path << RESET_TEXT << std::endl;
+        return;
+    }
+
+    for (const auto& [fen, move, weight, expected] : bookCases)
+    {
+        Book::BookMove moves[MAX_MOVES];
+        int count = Book::probe(pos.Set(fen, &posInfo), moves, MAX_MOVES);
+        bool found = false;
+
+        // An illegal move of the book must not be returned at all
+        for (int i = 0; i < count; i++)
+            found |= (UCI::moveToString(moves[i].move) == (expected.empty() ? move : expected) && moves[i].weight == weight);
+
+        bool ok = (found != expected.empty());
+
+        passed &= ok;
+        std::cout << fen << "  " << move << " -> " << (expected.empty() ? "illegal" : expected) << " - "
+                  << (ok ? GREEN_TEXT "PASSED" : RED_TEXT "FAILED") << RESET_TEXT << std::endl;
+    }
+
+    // Random games from the start position, mostly out of the book after a few moves
+    constexpr int numPositions = 4096;
+    constexpr int rounds = 64;
+
+    std::vector<Position> positions(numPositions);
+    std::vector<PosInfo> posInfos(numPositions);
+    int numInBook = 0;
+
+    for (int i = 0; i < numPositions; i++)
+    {
+        PosInfo gameInfos[16];
+        MoveList moveList;
+
+        int gameLength = int(rng() % 16);
+
+        pos.Set(startPosFEN, &posInfo);
+
+        for (int ply = 0; ply < gameLength; ply++)
+        {
+            MoveGen::generate(pos, moveList);
+
+            if (moveList.count == 0)
+                break;
+
+            pos.MakeMove(moveList.moves[rng() % moveList.count].move, gameInfos[ply]);
+            moveList.count = 0;
+        }
+
+        positions[i].Set(pos.FEN(), &posInfos[i]);
+        numInBook += (Book::probe(positions[i]) != MOVE_NONE);
+    }
+
+    uint64_t checksum = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+
+    for (int round = 0; round < rounds; round++)
+        for (int i = 0; i < numPositions; i++)
+            checksum += Book::probe(positions[i]);
+
+    auto stop = std::chrono::high_resolution_clock::now();
+    double nanos = double(std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count());
+
+    std::cout << "Entries: " << entries.size() << "  Positions in the book: " << numInBook << " of " << numPositions << "\n";
+    std::cout << "Probes: " << numPositions * rounds << "  ns/probe: " << nanos / (numPositions * rounds)
+              << "  checksum: " << checksum << "\n";
+
+    Book::close();
+    std::remove(path.c_str());
+
+    std::cout << (passed ? GREEN_TEXT "PASSED" : RED_TEXT "FAILED") << RESET_TEXT << std::endl;
+}
+
+// Plays knight moves back and forth and checks the distance to the previous occurrence of the
+// position after every move. A pawn move in between makes the earlier positions unreachable.
+void repetition()
+{
+    const std::vector<std::pair<std::string, int>> moves =
+    {
+        {"g1f3", 0}, {"g8f6", 0}, {"f3g1", 0}, {"f6g8",  4},
+        {"g1f3", 4}, {"g8f6", 4}, {"f3g1", 4}, {"f6g8", -4},
+        {"e2e4", 0}, {"g8f6", 0}, {"g1f3", 0}, {"f6g8", 0},
+        {"f3g1", 4}, {"g8f6", 4}, {"g1f3", 4}, {"f6g8", 4},
+    };
+
+    Position pos;
+    PosInfo posInfos[17];
+    bool passed = true;
+
+    pos.Set(startPosFEN, &posInfos[0]);
+
+    for (size_t i = 0; i < moves.size(); i++)
+    {
+        Move move = findMove(pos, moves[i].first);
+        pos.MakeMove(move, posInfos[i + 1]);
+
+        int repetition = posInfos[i + 1].repetition;
+        bool ok = (repetition == moves[i].second);
+
+        passed &= ok;
+        std::cout << moves[i].first << "  Repetition: " << repetition << "  Expected: " << moves[i].second
+                  << "  Draw at ply 1: " << pos.IsRepetition(1) << " - "
+                  << (ok ? GREEN_TEXT "PASSED" : RED_TEXT "FAILED") << RESET_TEXT << std::endl;
+    }
+
+    std::cout << (passed ? GREEN_TEXT "PASSED" : RED_TEXT "FAILED") << RESET_TEXT << std::endl;
+}
+
+// Starts the engine in UCI mode a number of times and measures the time
+// from launching the process until it answers the first isready
+void startup(const std::string& engine)
+{
+    constexpr int runs = 20;
+
+    std::string command = "echo isready | \"" + engine + "\" uci";
+    int64_t minMicros = INT64_MAX, totalMicros = 0;
+
+    for (int i = 0; i < runs; i++)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+
+        FILE* pipe = popen(command.c_str(), "r");
+
+        if (!pipe)
+        {
+            std::cout << RED_TEXT << "FAILED" << RESET_TEXT << " to start " << engine << std::endl;
+            return;
+        }
+
+        char line[256];
+        bool ready = false;
+
+        while (!ready && fgets(line, sizeof(line), pipe))
+            ready = (std::string(line) == "readyok\n");
+
+        auto stop = std::chrono::high_resolution_clock::now();
+        pclose(pipe);
+
+        if (!ready)
+        {
+            std::cout << RED_TEXT << "FAILED" << RESET_TEXT << " no readyok from " << engine << std::endl;
+            return;
+        }
+
+        int64_t micros = std::chrono::duration_cast<std::chrono::microseconds>(stop - start).count();
+        minMicros = std::min(minMicros, micros);
+        totalMicros += micros;
+    }
+
+    std::cout << "Startup to readyok over " << runs << " runs\n";
+    std::cout << "Min: "     << minMicros / 1000.0            << " ms\n";
+    std::cout << "Average: " << totalMicros / runs / 1000.0 << " ms" << std::endl;
+}
+
+// Plays the search and endgame positions one after another as the moves of a game under each of the
+// time controls. The clock is fake, time passes with the nodes searched, so the results are the same
+// on every machine. Every move also loses some time to lag, as it would between the engine and a GUI.
+void timeSimulation()
+{
+    constexpr uint64_t nodesPerMs = 1000;
+    constexpr int64_t lag = 10;
+    constexpr int numMoves = 80;
+
+    std::vector<std::string> fens(searchCases);
+    fens.insert(fens.end(), endgameCases.begin(), endgameCases.end());
+
+    Position pos;
+    PosInfo posInfo;
+    bool passed = true;
+
+    for (const auto& [name, clock, inc, movesPerControl] : timeControls)
+    {
+        Search::Limits limits;
+        int64_t timeLeft = clock, minTimeLeft = clock, maxMoveTime = 0, totalTime = 0;
+        int hardStops = 0, unsearched = 0, movesToGo = movesPerControl;
+        bool flagged = false, clockUsed = true;
+
+        TT.Clear();
+
+        for (int move = 0; move < numMoves && !flagged; move++)
+        {
+            pos.Set(fens[move % fens.size()], &posInfo);
+            Color us = pos.SideToMove();
+
+            limits.time[us]    = timeLeft;
+            limits.inc[us]     = inc;
+            limits.movestogo   = movesToGo;
+            limits.nodesPerMs  = nodesPerMs;
+
+            Search::go(pos, limits, false);
+
+            int64_t moveTime = Search::info().time + lag;
+
+            hardStops  += (Search::info().time >= Time.Maximum());
+            unsearched += (Search::info().depth == 0);
+            timeLeft   -= moveTime;
+            flagged     = (timeLeft < 0);
+            timeLeft   += inc;
+            minTimeLeft = std::min(minTimeLeft, timeLeft);
+            maxMoveTime = std::max(maxMoveTime, moveTime);
+            totalTime  += moveTime;
+
+            // The clock is refilled at the time control, half of it should have been used by then
+            if (movesPerControl && --movesToGo == 0)
+            {
+                clockUsed &= (timeLeft < clock / 2);
+                timeLeft  += clock;
+                movesToGo  = movesPerControl;
+            }
+        }
+
+        bool ok = !flagged && clockUsed;
+        passed &= ok;
+
+        std::cout << std::left << std::setw(8) << name << std::right
+                  << "  Average: "   << std::setw(5) << totalTime / numMoves << " ms"
+                  << "  Max: "       << std::setw(5) << maxMoveTime << " ms"
+                  << "  Least left: " << std::setw(6) << minTimeLeft << " ms"
+                  << "  Left: "      << std::setw(6) << timeLeft << " ms"
+                  << "  Hard stops: " << hardStops
+                  << "  Unsearched: " << unsearched
+                  << " - " << (ok ? GREEN_TEXT "PASSED" : flagged ? RED_TEXT "LOST ON TIME" : RED_TEXT "FAILED") << RESET_TEXT << std::endl;
+    }
+
+    std::cout << (passed ? GREEN_TEXT "PASSED" : RED_TEXT "FAILED") << RESET_TEXT << std::endl;
+}
+
+// Drives the engine through pipes as a GUI would. Measures how long isready and stop take to be
+// answered while the engine searches on the given number of threads, and checks that every go gets
+// exactly one bestmove, also when stop comes after the search has already ended.
+void uciLatency(const std::string& engine, int numThreads)
+{
+#if defined(_WIN32)
+    (void)engine;
+    (void)numThreads;
+    std::cout << "Not supported on Windows" << std::endl;
+#else
+    EngineProcess process(engine);
+
+    if (!process.running())
+    {
+        std::cout << RED_TEXT << "FAILED" << RESET_TEXT << " to start " << engine << std::endl;
+        return;
+    }
+
+    using Clock = std::chrono::steady_clock;
+    constexpr int rounds = 20;
+
+    auto micros = [](Clock::time_point start) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+    };
+
+    process.send("uci");
+    process.readUntil("uciok");
+    process.send("setoption name Threads value " + std::to_string(numThreads));
+    process.send("setoption name OwnBook value false");
+    process.send("isready");
+    process.readUntil("readyok");
+
+    int64_t maxReady = 0, maxStop = 0, totalReady = 0, totalStop = 0;
+    int bestMoves = 0, goCommands = 0;
+
+    for (int i = 0; i < rounds; i++)
+    {
+        process.send("position startpos moves e2e4");
+        process.send("go infinite");
+        goCommands++;
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+        auto start = Clock::now();
+        process.send("isready");
+        bestMoves += process.readUntil("readyok");
+
+        int64_t ready = micros(start);
+
+        start = Clock::now();
+        process.send("stop");
+        bestMoves += process.readUntil("bestmove");
+
+        int64_t stop = micros(start);
+
+        maxReady = std::max(maxReady, ready);
+        maxStop  = std::max(maxStop, stop);
+        totalReady += ready;
+        totalStop  += stop;
+
+        // A search that is over before stop
+        process.send("go depth 1");
+        goCommands++;
+        bestMoves += process.readUntil("bestmove");
+        process.send("stop");
+    }
+
+    // Any bestmove sent twice shows up before readyok
+    process.send("isready");
+    bestMoves += process.readUntil("readyok");
+    process.send("quit");
+
+    bool ok = (bestMoves == goCommands);
+
+    std::cout << "Threads: " << numThreads << "  Rounds: " << rounds << "\n";
+    std::cout << "isready  Average: " << totalReady / rounds << " us  Max: " << maxReady << " us\n";
+    std::cout << "stop     Average: " << totalStop  / rounds << " us  Max: " << maxStop  << " us\n";
+    std::cout << "Go commands: " << goCommands << "  bestmoves: " << bestMoves << "\n";
+    std::cout << (ok ? GREEN_TEXT "PASSED" : RED_TEXT "FAILED") << RESET_TEXT << std::endl;
+#endif
+}
+
 } // namespace Test
 
 } // namespace ChessEngine
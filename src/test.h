@@ -1,11 +1,31 @@
 #ifndef TEST_INCLUDED
 #define TEST_INCLUDED
 
+#include <string>
+
 namespace ChessEngine {
 
 namespace Test {
 
 void perft();
+void perftCache();
+void perftThreads(int numThreads);
+void searchBench(int depth);
+void endgameBench(int depth);
+void smpBench(int depth);
+void bench();
+void moveCount();
+void sliders();
+void makeMove();
+void nnueBench();
+void see();
+void kpk();
+void tablebases(const std::string& directory);
+void book(const std::string& path);
+void repetition();
+void startup(const std::string& engine);
+void uciLatency(const std::string& engine, int numThreads);
+void timeSimulation();
 
 } // namespace Test
 
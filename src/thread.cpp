@@ -0,0 +1,127 @@
+#include <cstring>
+
+#include "thread.h"
+
+namespace ChessEngine {
+
+ThreadPool Threads;
+
+Thread::Thread(int id) : id(id), history(), pawnTable(), materialTable(), stdThread(&Thread::IdleLoop, this)
+{
+    // Wait until the thread is parked
+    WaitForSearchFinished();
+}
+
+Thread::~Thread()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        exit = true;
+        searching = true;
+    }
+
+    cv.notify_one();
+    stdThread.join();
+}
+
+void Thread::StartSearching()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        searching = true;
+    }
+
+    cv.notify_one();
+}
+
+void Thread::WaitForSearchFinished()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [&] { return !searching; });
+}
+
+void Thread::IdleLoop()
+{
+    while (true)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        searching = false;
+        cv.notify_one();
+        cv.wait(lock, [&] { return searching; });
+
+        if (exit)
+            return;
+
+        lock.unlock();
+
+        IterativeDeepening();
+    }
+}
+
+void ThreadPool::Set(size_t numThreads)
+{
+    if (!threads.empty())
+        WaitForSearchFinished();
+
+    for (Thread* thread : threads)
+        delete thread;
+
+    threads.clear();
+
+    for (size_t i = 0; i < numThreads; i++)
+        threads.push_back(new Thread(int(i)));
+}
+
+void ThreadPool::StartThinking(const Position& pos)
+{
+    WaitForSearchFinished();
+
+    for (Thread* thread : threads)
+    {
+        thread->rootPos.Set(pos, &thread->rootPosInfo);
+        thread->nodes.store(0, std::memory_order_relaxed);
+        thread->seldepth = 0;
+        thread->completedDepth = 0;
+        thread->bestScore = -VALUE_INFINITE;
+        thread->bestMove = MOVE_NONE;
+        thread->pvLength[0] = 0;
+        thread->pickerNodes = 0;
+        thread->capturesSkipped = 0;
+        thread->quietsSkipped = 0;
+        thread->qsearchNodes = 0;
+        thread->tbHits = 0;
+        thread->pawnTable.probes = 0;
+        thread->pawnTable.hits = 0;
+        thread->materialTable.probes = 0;
+        thread->materialTable.hits = 0;
+
+        // Killers only make sense within one search, the history is
+        // kept but halved so that it adapts to the new position
+        std::memset(thread->killers, 0, sizeof(thread->killers));
+
+        for (auto& fromTable : thread->history.table)
+            for (auto& toTable : fromTable)
+                for (int& entry : toTable)
+                    entry /= 2;
+    }
+
+    // The main thread wakes up the helpers once it starts
+    Main()->StartSearching();
+}
+
+void ThreadPool::WaitForSearchFinished() const
+{
+    Main()->WaitForSearchFinished();
+}
+
+uint64_t ThreadPool::NodesSearched() const
+{
+    uint64_t nodes = 0;
+
+    for (const Thread* thread : threads)
+        nodes += thread->nodes.load(std::memory_order_relaxed);
+
+    return nodes;
+}
+
+} // namespace ChessEngine
@@ -0,0 +1,106 @@
+#ifndef THREAD_INCLUDED
+#define THREAD_INCLUDED
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "defs.h"
+#include "position.h"
+#include "movepick.h"
+#include "material.h"
+#include "pawns.h"
+
+namespace ChessEngine {
+
+// A search thread. It owns a copy of the root position with its own PosInfo stack and
+// stays parked in IdleLoop between searches instead of being created for every search.
+class Thread {
+public:
+    explicit Thread(int id);
+    Thread(const Thread&) = delete;
+    ~Thread();
+
+    // Wakes the thread up to search the root position
+    void StartSearching();
+    void WaitForSearchFinished();
+
+    // The iterative deepening loop, implemented in search.cpp
+    void IterativeDeepening();
+
+    int id;
+    Position rootPos;
+    PosInfo rootPosInfo;
+
+    // Written by the owning thread only, read by the main thread for the totals
+    std::atomic<uint64_t> nodes;
+    int seldepth;
+    int completedDepth;
+    int bestScore;
+    Move bestMove;
+
+    // Triangular PV table, row ply holds the principal variation found from that ply.
+    // See: https://www.chessprogramming.org/Triangular_PV-Table
+    Move pv[MAX_PLY + 1][MAX_PLY + 1];
+    int pvLength[MAX_PLY + 1];
+
+    // Move ordering
+    Move killers[MAX_PLY + 1][2];
+    ButterflyHistory history;
+
+    // Nodes where the move picker was used and how many of them
+    // cut off before the captures or the quiets were generated
+    uint64_t pickerNodes;
+    uint64_t capturesSkipped;
+    uint64_t quietsSkipped;
+
+    // Nodes searched by the quiescence search, included in nodes
+    uint64_t qsearchNodes;
+
+    // Nodes scored by the tablebases
+    uint64_t tbHits;
+
+    // Kept between searches, the probe and hit counters are reset for each search
+    Pawns::Table pawnTable;
+    Material::Table materialTable;
+
+private:
+    void IdleLoop();
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool searching = true;
+    bool exit = false;
+
+    // Must be the last member to start after the rest of the thread is constructed
+    std::thread stdThread;
+};
+
+// The pool of search threads. Thread 0 is the main thread, it checks the
+// limits, reports the search and collects the result of the helpers.
+class ThreadPool {
+public:
+    ~ThreadPool() { Set(0); }
+
+    // Creates the given number of threads, joining the current ones
+    void Set(size_t numThreads);
+
+    // Copies the root position to every thread and wakes them up
+    void StartThinking(const Position& pos);
+    void WaitForSearchFinished() const;
+
+    uint64_t NodesSearched() const;
+
+    inline Thread* Main() const { return threads.front(); }
+    inline size_t Size() const { return threads.size(); }
+
+    std::vector<Thread*> threads;
+};
+
+extern ThreadPool Threads;
+
+} // namespace ChessEngine
+
+#endif // THREAD_INCLUDED
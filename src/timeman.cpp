@@ -0,0 +1,77 @@
+#include <algorithm>
+
+#include "timeman.h"
+#include "thread.h"
+
+namespace ChessEngine {
+
+TimeManager Time;
+
+namespace {  // anonymous namespace
+
+// Without movestogo the rest of the game is assumed to take this many moves. The remaining
+// time shrinks with every move, so the share of a move shrinks too and the clock never runs out.
+constexpr int DEFAULT_MOVES_TO_GO = 40;
+constexpr int MAX_MOVES_TO_GO     = 50;
+
+// How many times the optimum time the maximum time can be, and how much of the clock it can take
+constexpr double MAX_TIME_RATIO = 5.0;
+constexpr double MAX_CLOCK_SHARE = 0.8;
+
+// The scale of the soft limit by the iterations since the best move last changed
+constexpr double StabilityScale[] = { 1.8, 1.4, 1.15, 1.0, 0.9, 0.8 };
+constexpr int MAX_STABLE_ITERATIONS = 5;
+
+// The soft limit grows by this much for every centipawn the score drops, up to twice its size
+constexpr double SCORE_DROP_SCALE = 0.01;
+constexpr double MAX_SCORE_DROP_FACTOR = 2.0;
+
+// An iteration takes about as long as all the iterations before it, so one that starts past this
+// share of the soft limit is expected to end well beyond it
+constexpr double NEXT_ITERATION_SHARE = 0.5;
+
+} // anonymous namespace
+
+void TimeManager::Init(const Search::Limits& limits, Color us)
+{
+    startTime  = std::chrono::steady_clock::now();
+    nodesPerMs = limits.nodesPerMs;
+    managed    = (limits.time[us] > 0 && !limits.movetime && !limits.infinite);
+
+    if (!managed)
+        return;
+
+    int64_t time = limits.time[us];
+    int64_t inc  = limits.inc[us];
+    int movesToGo = (limits.movestogo ? std::min(limits.movestogo, MAX_MOVES_TO_GO) : DEFAULT_MOVES_TO_GO);
+
+    // The time of the moves until the next time control, with the increments that come with
+    // them and less the overhead of each of them, and some overhead to spare on top
+    int64_t timeLeft = std::max<int64_t>(1, time + inc * (movesToGo - 1) - int64_t(moveOverhead) * (movesToGo + 2));
+
+    optimumTime = timeLeft / movesToGo;
+    maximumTime = std::min(int64_t(optimumTime * MAX_TIME_RATIO), int64_t(time * MAX_CLOCK_SHARE) - moveOverhead);
+    maximumTime = std::max<int64_t>(maximumTime, 1);
+    optimumTime = std::clamp<int64_t>(optimumTime, 1, maximumTime);
+}
+
+int64_t TimeManager::Elapsed() const
+{
+    if (nodesPerMs)
+        return int64_t(Threads.NodesSearched() / nodesPerMs);
+
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+bool TimeManager::SoftLimitReached(int stableIterations, int scoreDrop) const
+{
+    if (!managed)
+        return false;
+
+    double stability = StabilityScale[std::min(stableIterations, MAX_STABLE_ITERATIONS)];
+    double drop      = std::clamp(1.0 + scoreDrop * SCORE_DROP_SCALE, 1.0, MAX_SCORE_DROP_FACTOR);
+
+    return Elapsed() >= std::min(double(maximumTime), optimumTime * stability * drop) * NEXT_ITERATION_SHARE;
+}
+
+} // namespace ChessEngine
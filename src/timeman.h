@@ -0,0 +1,54 @@
+#ifndef TIMEMAN_INCLUDED
+#define TIMEMAN_INCLUDED
+
+#include <chrono>
+#include <cstdint>
+
+#include "defs.h"
+#include "search.h"
+
+namespace ChessEngine {
+
+// Decides how long to think on a move from the clock. The optimum time is what a move should take
+// on average, the search does not start another iteration past it once scaled by how settled the
+// search is. The maximum time is a hard limit that ends the search in the middle of an iteration.
+class TimeManager {
+public:
+    // Time lost between the engine and the clock of the GUI on every move, in milliseconds
+    static constexpr int DEFAULT_MOVE_OVERHEAD = 30;
+
+    // Starts the clock of a search and sets the limits from the clock of the side to move.
+    // Only searches with a clock are managed, movetime is a fixed time and an infinite search
+    // (or a ponder) only ends when the GUI stops it.
+    void Init(const Search::Limits& limits, Color us);
+
+    // Milliseconds since Init, or the nodes searched converted to milliseconds with a fake clock
+    int64_t Elapsed() const;
+
+    // Whether the search should not start another iteration. The soft limit grows while the best
+    // move keeps changing between iterations or the score drops, and shrinks as the best move
+    // stays the same. stableIterations counts the iterations since the best move last changed,
+    // scoreDrop is how much the score fell from the previous iteration in centipawns.
+    bool SoftLimitReached(int stableIterations, int scoreDrop) const;
+
+    bool HardLimitReached() const { return managed && Elapsed() >= maximumTime; }
+
+    inline bool Managed() const       { return managed; }
+    inline int64_t Optimum() const    { return optimumTime; }
+    inline int64_t Maximum() const    { return maximumTime; }
+
+    int moveOverhead = DEFAULT_MOVE_OVERHEAD;
+
+private:
+    std::chrono::steady_clock::time_point startTime;
+    uint64_t nodesPerMs = 0;
+    bool managed = false;
+    int64_t optimumTime = 0;
+    int64_t maximumTime = 0;
+};
+
+extern TimeManager Time;
+
+} // namespace ChessEngine
+
+#endif // TIMEMAN_INCLUDED
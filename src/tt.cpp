@@ -0,0 +1,195 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+#include "tt.h"
+
+namespace ChessEngine {
+
+TranspositionTable TT;
+
+namespace {  // anonymous namespace
+
+// The packed data word of an entry:
+//
+// bit  0-15:    Move
+// bit 16-31:    score
+// bit 32-47:    static evaluation
+// bit 48-55:    depth + DEPTH_OFFSET
+// bit 56-57:    Bound
+// bit 58-63:    generation
+constexpr uint64_t pack(Move move, int score, int eval, int depth, Bound bound, int generation)
+{
+    return  uint64_t(move)
+         | (uint64_t(uint16_t(score)) << 16)
+         | (uint64_t(uint16_t(eval))  << 32)
+         | (uint64_t(depth + TranspositionTable::DEPTH_OFFSET) << 48)
+         | (uint64_t(bound) << 56)
+         | (uint64_t(generation) << 58);
+}
+
+constexpr Move  dataMove(uint64_t data)       { return Move(data & 0xFFFF); }
+constexpr int   dataScore(uint64_t data)      { return int16_t((data >> 16) & 0xFFFF); }
+constexpr int   dataEval(uint64_t data)       { return int16_t((data >> 32) & 0xFFFF); }
+constexpr int   dataDepth(uint64_t data)      { return int((data >> 48) & 0xFF) - TranspositionTable::DEPTH_OFFSET; }
+constexpr Bound dataBound(uint64_t data)      { return Bound((data >> 56) & 0x3); }
+constexpr int   dataGeneration(uint64_t data) { return int(data >> 58); }
+
+} // anonymous namespace
+
+TranspositionTable::~TranspositionTable()
+{
+    std::free(table);
+}
+
+void TranspositionTable::Resize(size_t megabytes, int numThreads /*= 1*/)
+{
+    std::free(table);
+
+    // Align to the size of a large page, aligned_alloc needs the size to be a multiple of it
+    constexpr size_t alignment = 2 * 1024 * 1024;
+
+    numBuckets = megabytes * 1024 * 1024 / sizeof(Bucket);
+    size_t allocSize = (numBuckets * sizeof(Bucket) + alignment - 1) / alignment * alignment;
+    table = static_cast<Bucket*>(std::aligned_alloc(alignment, allocSize));
+
+    if (!table)
+    {
+        std::cerr << "Failed to allocate " << megabytes << " MB for the transposition table" << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    // Large pages reduce the TLB misses of random accesses into the table
+    madvise(table, allocSize, MADV_HUGEPAGE);
+#endif
+
+    Clear(numThreads);
+}
+
+void TranspositionTable::Clear(int numThreads /*= 1*/)
+{
+    std::vector<std::thread> threads;
+
+    // Page faults and zeroing of a multi-GB table take seconds on one thread,
+    // so each thread zeroes its own slice of the table
+    for (int i = 0; i < numThreads; i++)
+    {
+        threads.emplace_back([this, i, numThreads]() {
+            size_t stride = numBuckets / numThreads;
+            size_t start  = stride * i;
+            size_t length = (i == numThreads - 1 ? numBuckets - start : stride);
+
+            std::memset(static_cast<void*>(&table[start]), 0, length * sizeof(Bucket));
+        });
+    }
+
+    for (std::thread& thread : threads)
+        thread.join();
+
+    generation = 0;
+}
+
+bool TranspositionTable::Probe(Key key, TTData& ttData) const
+{
+    Entry* entry = FirstEntry(key);
+
+    for (int i = 0; i < ENTRIES_PER_BUCKET; i++)
+    {
+        uint64_t data = entry[i].data.load(std::memory_order_relaxed);
+
+        if ((entry[i].keyXorData.load(std::memory_order_relaxed) ^ data) != key || !data)
+            continue;
+
+        ttData.move  = dataMove(data);
+        ttData.score = dataScore(data);
+        ttData.eval  = dataEval(data);
+        ttData.depth = dataDepth(data);
+        ttData.bound = dataBound(data);
+
+        return true;
+    }
+
+    return false;
+}
+
+void TranspositionTable::Store(Key key, Move move, int score, int eval, int depth, Bound bound)
+{
+    assert(depth >= -DEPTH_OFFSET && depth < 256 - DEPTH_OFFSET);
+
+    Entry* entry   = FirstEntry(key);
+    Entry* replace = entry;
+    int replaceWorth = INT32_MAX;
+
+    for (int i = 0; i < ENTRIES_PER_BUCKET; i++)
+    {
+        uint64_t data = entry[i].data.load(std::memory_order_relaxed);
+
+        // Empty entry
+        if (!data)
+        {
+            replace = &entry[i];
+            break;
+        }
+
+        // Same position, only overwrite it if the new result is at least about as deep,
+        // exact or the old one is from an earlier search. Keep the old move if there is no new one.
+        if ((entry[i].keyXorData.load(std::memory_order_relaxed) ^ data) == key)
+        {
+            if (   bound != BOUND_EXACT
+                && depth < dataDepth(data) - 3
+                && dataGeneration(data) == generation)
+                return;
+
+            if (move == MOVE_NONE)
+                move = dataMove(data);
+
+            replace = &entry[i];
+            break;
+        }
+
+        // Otherwise prefer to replace shallow entries from earlier searches
+        int age   = (generation - dataGeneration(data)) & GENERATION_MASK;
+        int worth = dataDepth(data) - 8 * age;
+
+        if (worth < replaceWorth)
+        {
+            replace = &entry[i];
+            replaceWorth = worth;
+        }
+    }
+
+    uint64_t data = pack(move, score, eval, depth, bound, generation);
+
+    replace->keyXorData.store(key ^ data, std::memory_order_relaxed);
+    replace->data.store(data, std::memory_order_relaxed);
+}
+
+int TranspositionTable::Hashfull() const
+{
+    size_t sampleSize = std::min<size_t>(1000, numBuckets);
+    size_t count = 0;
+
+    for (size_t i = 0; i < sampleSize; i++)
+    {
+        for (const Entry& entry : table[i].entries)
+        {
+            uint64_t data = entry.data.load(std::memory_order_relaxed);
+
+            if (data && dataGeneration(data) == generation)
+                count++;
+        }
+    }
+
+    return sampleSize ? int(count * 1000 / (sampleSize * ENTRIES_PER_BUCKET)) : 0;
+}
+
+} // namespace ChessEngine
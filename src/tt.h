@@ -0,0 +1,101 @@
+#ifndef TT_INCLUDED
+#define TT_INCLUDED
+
+#include <atomic>
+#include <cstddef>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "defs.h"
+
+namespace ChessEngine {
+
+// The decoded content of a transposition table entry
+struct TTData
+{
+    Move move;
+    int score;
+    int eval;
+    int depth;
+    Bound bound;
+};
+
+// A shared hash table of search results. Entries are written and read without locks
+// by any number of threads. Each entry is two 64 bit words, the packed data and the
+// position key XORed with that data. A torn write from two threads racing on the same
+// entry makes the key check fail, so a probe never returns data from another position.
+// For reference, see: https://www.chessprogramming.org/Shared_Hash_Table#Lockless
+class TranspositionTable {
+public:
+    static constexpr int DEPTH_OFFSET = 16;
+
+    TranspositionTable() = default;
+    TranspositionTable(const TranspositionTable&) = delete;
+    ~TranspositionTable();
+
+    // Reallocates the table to the given size in megabytes and clears it
+    void Resize(size_t megabytes, int numThreads = 1);
+
+    // Zeroes the table, splitting the work between the given number of threads
+    void Clear(int numThreads = 1);
+
+    // Called once at the start of each search to age the entries of earlier searches
+    void NewSearch() { generation = (generation + 1) & GENERATION_MASK; }
+
+    bool Probe(Key key, TTData& data) const;
+    void Store(Key key, Move move, int score, int eval, int depth, Bound bound);
+
+    // Fetches the bucket of the given key into the cache ahead of a probe, so that
+    // callers can fire it right before MakeMove and overlap the memory latency with it
+    inline void Prefetch(Key key) const
+    {
+    #if defined(__GNUC__)
+        __builtin_prefetch(FirstEntry(key));
+    #else
+        _mm_prefetch((const char*)FirstEntry(key), _MM_HINT_T0);
+    #endif
+    }
+
+    // Approximates how full the table is in permill by sampling the first buckets
+    int Hashfull() const;
+
+private:
+    struct Entry
+    {
+        std::atomic<uint64_t> keyXorData;
+        std::atomic<uint64_t> data;
+    };
+
+    static constexpr int ENTRIES_PER_BUCKET = 4;
+    static constexpr int GENERATION_MASK    = 0x3F;
+
+    struct alignas(64) Bucket
+    {
+        Entry entries[ENTRIES_PER_BUCKET];
+    };
+
+    static_assert(sizeof(Bucket) == 64, "A bucket must fill exactly one cache line");
+
+    // Maps the key onto a bucket with the high half of a 64x64 bit multiplication,
+    // which spreads the keys evenly over any number of buckets
+    inline Entry* FirstEntry(Key key) const
+    {
+    #if defined(__GNUC__)
+        return table[(unsigned __int128)(key) * numBuckets >> 64].entries;
+    #else
+        return table[__umulh(key, numBuckets)].entries;
+    #endif
+    }
+
+    Bucket* table = nullptr;
+    size_t numBuckets = 0;
+    uint8_t generation = 0;
+};
+
+extern TranspositionTable TT;
+
+} // namespace ChessEngine
+
+#endif // TT_INCLUDED
@@ -1,60 +1,454 @@
+#include <algorithm>
+#include <charconv>
+#include <deque>
 #include <iostream>
+#include <mutex>
 #include <sstream>
+#include <string_view>
 
 #include "uci.h"
 #include "defs.h"
+#include "book.h"
 #include "position.h"
 #include "movegen.h"
+#include "nnue.h"
+#include "search.h"
+#include "tablebase.h"
+#include "thread.h"
+#include "timeman.h"
+#include "tt.h"
 
 namespace ChessEngine {
 
-void UCI::loop()
+namespace {  // anonymous namespace
+
+constexpr const char* ENGINE_NAME   = "ChessEngine";
+constexpr const char* ENGINE_AUTHOR = "vetarN9";
+
+std::mutex outputMutex;
+
+// The position of the game and the states of all its plies. The search threads read the earlier
+// plies to detect repetitions, so they are only replaced once the search has finished.
+Position pos;
+std::deque<PosInfo> posInfos(1);
+
+bool ownBook = true;
+
+// An option the GUI can set, with a function that applies the new value
+struct Option
 {
-    Position pos;
-    PosInfo posInfo;
-    MoveList moveList;
+    std::string name;
+    std::string type;
+    std::string defaultValue;
+    int min, max;
+    void (*apply)(const std::string& value);
+};
+
+const Option options[] =
+{
+    { "Hash",            "spin",   "16",  1, 1 << 20,
+        [](const std::string& value) { TT.Resize(std::stoul(value), int(Threads.Size())); } },
+
+    { "Threads",         "spin",   "1",   1, 1024,
+        [](const std::string& value) { Threads.Set(std::stoul(value)); } },
+
+    { "Move Overhead",   "spin",   std::to_string(TimeManager::DEFAULT_MOVE_OVERHEAD), 0, 5000,
+        [](const std::string& value) { Time.moveOverhead = std::stoi(value); } },
+
+    { "Clear Hash",      "button", "",    0, 0,
+        [](const std::string&) { TT.Clear(int(Threads.Size())); } },
+
+    { "OwnBook",         "check",  "true", 0, 0,
+        [](const std::string& value) { ownBook = (value == "true"); } },
+
+    { "BookFile",        "string", Book::DEFAULT_FILE, 0, 0,
+        [](const std::string& value) {
+            if (!Book::open(value))
+                UCI::send("info string Book " + value + " not found");
+        } },
+
+    { "EvalFile",        "string", NNUE::DEFAULT_FILE, 0, 0,
+        [](const std::string& value) {
+            if (!NNUE::load(value))
+                UCI::send("info string Network " + value + " not found, keeping the current evaluation");
+        } },
+
+    { "TablebasePath",   "string", Tablebases::DEFAULT_DIRECTORY, 0, 0,
+        [](const std::string& value) {
+            UCI::send("info string " + std::to_string(Tablebases::init(value)) + " tablebases found in " + value);
+        } },
+};
+
+// The commands below change what the search reads, so a running search is stopped first. It
+// still sends its bestmove, there is exactly one for every go.
+void waitForSearch()
+{
+    Search::stop();
+    Threads.WaitForSearchFinished();
+}
+
+void sendEngineInfo()
+{
+    UCI::send(std::string("id name ") + ENGINE_NAME);
+    UCI::send(std::string("id author ") + ENGINE_AUTHOR);
+
+    for (const Option& option : options)
+    {
+        std::string line = "option name " + option.name + " type " + option.type;
+
+        if (option.type != "button")
+            line += " default " + (option.defaultValue.empty() ? "<empty>" : option.defaultValue);
+
+        if (option.type == "spin")
+            line += " min " + std::to_string(option.min) + " max " + std::to_string(option.max);
+
+        UCI::send(line);
+    }
+
+    UCI::send("uciok");
+}
+
+// setoption name <name> [value <value>], the name and the value can have spaces
+void setOption(std::istringstream& iss)
+{
+    std::string token, name, value;
+
+    iss >> token;
+
+    while (iss >> token && token != "value")
+        name += (name.empty() ? "" : " ") + token;
+
+    while (iss >> token)
+        value += (value.empty() ? "" : " ") + token;
+
+    for (const Option& option : options)
+    {
+        if (option.name != name)
+            continue;
+
+        // A bad value keeps the current one. Spins reach apply() as a plain number in range.
+        if (option.type == "spin")
+        {
+            int number;
+            auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), number);
+
+            if (error == std::errc::result_out_of_range)
+                number = (value[0] == '-' ? option.min : option.max);
+
+            else if (value.empty() || error != std::errc() || end != value.data() + value.size())
+            {
+                UCI::send("info string Invalid value for " + name);
+                return;
+            }
+
+            value = std::to_string(std::clamp(number, option.min, option.max));
+        }
+
+        else if (option.type == "check" && value != "true" && value != "false")
+        {
+            UCI::send("info string Invalid value for " + name);
+            return;
+        }
+
+        option.apply(value);
+        return;
+    }
+
+    UCI::send("info string Unknown option " + name);
+}
+
+// Whether Position::Set can take the FEN: eight ranks of eight squares, one king of each color,
+// at most 16 pieces and 8 pawns of a color and MAX_PIECE_COUNT of a piece, which the material
+// key and the NNUE features are sized for, no pawn on the first or last rank, castling rights only with the king and the rook on their
+// squares and an en passant square behind a pawn that just moved two squares. The counters are
+// optional. Whether the side not to move is in check is left to the caller, it needs the board.
+bool isValidFEN(const std::string& fen)
+{
+    std::istringstream iss(fen);
+    std::string placement, side, castling = "-", enpassant = "-";
+    int fiftyMoveCounter = 0, fullmove = 1;
+
+    if (!(iss >> placement >> side))
+        return false;
+
+    // Fields that are missing keep their defaults, anything else must be read to the end
+    iss >> castling >> enpassant >> fiftyMoveCounter >> fullmove;
+
+    if (!iss.eof() || fiftyMoveCounter < 0 || fullmove < 1)
+        return false;
+
+    char board[NUM_SQUARES];
+    std::fill(board, board + NUM_SQUARES, ' ');
+
+    // The pieces in the order pawn to king for white and then for black
+    constexpr std::string_view PieceChars("PNBRQKpnbrqk");
+    constexpr int NUM_KINDS = 6;
+
+    int rank = 7, file = 0, counts[NUM_COLORS][NUM_KINDS] = {};
+
+    for (char c : placement)
+    {
+        size_t kind = PieceChars.find(c);
+
+        if (c == '/')
+        {
+            if (file != 8 || rank-- == 0)
+                return false;
+
+            file = 0;
+        }
+
+        else if (c >= '1' && c <= '8')
+            file += c - '0';
+
+        else if (kind != std::string_view::npos && file < 8)
+        {
+            if ((c == 'P' || c == 'p') && (rank == 0 || rank == 7))
+                return false;
+
+            if (++counts[kind / NUM_KINDS][kind % NUM_KINDS] > MAX_PIECE_COUNT)
+                return false;
+
+            board[8 * rank + file++] = c;
+        }
+
+        else
+            return false;
+
+        if (file > 8)
+            return false;
+    }
+
+    if (rank != 0 || file != 8)
+        return false;
+
+    for (Color color : {WHITE, BLACK})
+    {
+        int pieces = 0;
+
+        for (int kind = 0; kind < NUM_KINDS; kind++)
+            pieces += counts[color][kind];
+
+        if (counts[color][NUM_KINDS - 1] != 1 || counts[color][0] > 8 || pieces > 16)
+            return false;
+    }
 
-    std::string token, line;
+    if (side != "w" && side != "b")
+        return false;
 
-    pos.Set(startPosFEN, &posInfo);
+    // The king and the rook of every castling right on their squares
+    for (char c : (castling == "-" ? "" : castling))
+    {
+        bool white = (c == 'K' || c == 'Q');
+        int back   = (white ? 0 : 56);
+        int rook   = back + (c == 'K' || c == 'k' ? 7 : 0);
+
+        if (std::string_view("KQkq").find(c) == std::string_view::npos
+            || board[back + 4] != (white ? 'K' : 'k') || board[rook] != (white ? 'R' : 'r'))
+            return false;
+    }
+
+    // The en passant square and the square the pawn came from are empty, the pawn is right past them
+    if (enpassant != "-")
+    {
+        Color us = (side == "w" ? WHITE : BLACK);
+        int epRank = (us == WHITE ? 5 : 2);
+        int step   = (us == WHITE ? -8 : 8);
+
+        if (enpassant.size() != 2 || enpassant[0] < 'a' || enpassant[0] > 'h' || enpassant[1] != '1' + epRank)
+            return false;
+
+        int square = 8 * epRank + (enpassant[0] - 'a');
+
+        if (board[square] != ' ' || board[square - step] != ' ' || board[square + step] != (us == WHITE ? 'p' : 'P'))
+            return false;
+    }
+
+    return true;
+}
+
+// position [startpos | fen <fen>] [moves <move> ...]
+void setPosition(std::istringstream& iss)
+{
+    std::string token, fen;
+
+    iss >> token;
+
+    if (token == "startpos")
+    {
+        fen = startPosFEN;
+        iss >> token;
+    }
+
+    else if (token == "fen")
+        while (iss >> token && token != "moves")
+            fen += (fen.empty() ? "" : " ") + token;
 
-    std::istringstream iss;
+    else
+        return;
 
-    while (true)
+    // An invalid position keeps the current one, the search assumes both kings are on the board
+    // and the king of the side not to move can not be taken
+    Position newPos;
+    PosInfo newPosInfo;
+    bool valid = isValidFEN(fen);
+
+    if (valid)
     {
-        // Wait for input on cin
-        if (!getline(std::cin, line))
+        newPos.Set(fen, &newPosInfo);
+        valid = !newPos.SquareIsAttacked(newPos.KingSquare(~newPos.SideToMove()), newPos.SideToMove());
+    }
+
+    if (!valid)
+    {
+        UCI::send("info string Invalid position " + fen);
+        return;
+    }
+
+    posInfos = std::deque<PosInfo>(1);
+    pos.Set(fen, &posInfos.back());
+
+    // A deque keeps the states in place as it grows, the position points into it
+    while (iss >> token)
+    {
+        Move move = UCI::stringToMove(pos, token);
+
+        if (move == MOVE_NONE)
+        {
+            UCI::send("info string Illegal move " + token);
             break;
+        }
 
-        iss.str(line);
-        std::string token;
+        posInfos.emplace_back();
+        pos.MakeMove(move, posInfos.back());
+    }
+}
+
+// go [depth <plies>] [nodes <count>] [movetime <ms>] [infinite] [wtime <ms>] [btime <ms>]
+//    [winc <ms>] [binc <ms>] [movestogo <moves>]
+void go(std::istringstream& iss)
+{
+    Search::Limits limits;
+    std::string token;
 
-        // Tokenize the input string
-        while (iss >> token)
+    while (iss >> token)
+    {
+        if      (token == "depth")     iss >> limits.depth;
+        else if (token == "nodes")     iss >> limits.nodes;
+        else if (token == "movetime")  iss >> limits.movetime;
+        else if (token == "infinite")  limits.infinite = true;
+        else if (token == "wtime")     iss >> limits.time[WHITE];
+        else if (token == "btime")     iss >> limits.time[BLACK];
+        else if (token == "winc")      iss >> limits.inc[WHITE];
+        else if (token == "binc")      iss >> limits.inc[BLACK];
+        else if (token == "movestogo") iss >> limits.movestogo;
+    }
+
+    if (ownBook && !limits.infinite)
+    {
+        Move bookMove = Book::probe(pos);
+
+        if (bookMove != MOVE_NONE)
         {
-/*             if (token == "uci")
-                sendEngineInfo();
+            UCI::send("bestmove " + UCI::moveToString(bookMove));
+            return;
+        }
+    }
+
+    Search::start(pos, limits);
+}
+
+} // anonymous namespace
+
+void UCI::loop()
+{
+    std::string line, token;
+
+    pos.Set(startPosFEN, &posInfos.back());
+
+    // The end of the input is the same as quit
+    while (std::getline(std::cin, line))
+    {
+        std::istringstream iss(line);
 
-            else if (token == "isready")
-                sendReadyOk();
+        if (!(iss >> token))
+            continue;
 
-            else if (token == "position")
-                parsePosition(iss, pos);
+        if (token == "quit")
+            break;
+
+        else if (token == "stop")
+            Search::stop();
+
+        else if (token == "isready")
+            send("readyok");
 
-            else if (token == "go")
-                parseGo(iss, pos);
+        else if (token == "uci")
+            sendEngineInfo();
+
+        else if (token == "ucinewgame")
+        {
+            waitForSearch();
+            TT.Clear(int(Threads.Size()));
+        }
 
-            else if (token == "stop")
-                stopSearch();
+        else if (token == "setoption")
+        {
+            waitForSearch();
+            setOption(iss);
+        }
 
-            else if (token == "quit")
-                return; */
+        else if (token == "position")
+        {
+            waitForSearch();
+            setPosition(iss);
         }
 
-        // Clear the stringstream for the next iteration
-        iss.clear();
+        else if (token == "go")
+        {
+            waitForSearch();
+            go(iss);
+        }
+
+        else if (token == "d")
+            send(pos.FEN());
     }
-    
+
+    waitForSearch();
+}
+
+void UCI::send(const std::string& line)
+{
+    std::lock_guard<std::mutex> lock(outputMutex);
+    std::cout << line << std::endl;
+}
+
+std::string UCI::moveToString(Move move)
+{
+    if (move == MOVE_NONE)
+        return "(none)";
+
+    if (move == MOVE_NULL)
+        return "0000";
+
+    std::string moveStr = algebraicNotation(getFromSquare(move)) + algebraicNotation(getToSquare(move));
+
+    if (getMoveType(move) == PROMOTION)
+        moveStr += " pnbrqk"[getPromotionType(move)];
+
+    return moveStr;
+}
+
+Move UCI::stringToMove(const Position& pos, const std::string& moveString)
+{
+    MoveList moveList;
+    MoveGen::generate(pos, moveList);
+
+    for (int i = 0; i < moveList.count; i++)
+        if (moveToString(moveList.moves[i].move) == moveString)
+            return moveList.moves[i].move;
+
+    return MOVE_NONE;
 }
 
-} // namespace ChessEngine
\ No newline at end of file
+} // namespace ChessEngine
@@ -1,18 +1,32 @@
 #ifndef UCI_INCLUDED
 #define UCI_INCLUDED
 
+#include <string>
+
+#include "defs.h"
+
 namespace ChessEngine {
 
 class Position;
 
 namespace UCI {
 
-// The main loop of the engine. Waits for commands
-// on stdin and executes the corresponding function
+// The main loop of the engine. Waits for commands on stdin and executes them. The search runs
+// on the thread pool, so the loop keeps reading commands such as stop and isready while it does.
 void loop();
 
+// Writes the line and flushes it. The search and the command loop both write to stdout,
+// so every line of the engine goes through here to reach the GUI whole.
+void send(const std::string& line);
+
+// Converts a move to the long algebraic notation used by UCI, e.g. e2e4 or e7e8q
+std::string moveToString(Move move);
+
+// The legal move of the position in long algebraic notation, or MOVE_NONE
+Move stringToMove(const Position& pos, const std::string& moveString);
+
 } // namespace UCI
 
 } // namespace ChessEngine
 
-#endif // UCI_INCLUDED
\ No newline at end of file
+#endif // UCI_INCLUDED